@@ -0,0 +1,67 @@
+/*
+ * Layout of asset bundle files, as written by tools/bundlepack and mapped
+ * by the application.
+ *
+ * A bundle is a header, followed by a table of entries, followed by the data
+ * of the entries. All numbers are little endian. Everything is laid out so
+ * that the mapped file can be used in place: the entry table directly follows
+ * the 16-byte header, and the data of every entry and of every texture level
+ * starts at a multiple of bundle_alignment.
+ *
+ * Entries are named like the resources they replace, without the extension:
+ * ":/res/images/moon.bmp" is found as ":/res/images/moon", regardless of
+ * whether the bundle got it from a BMP, PNG or KTX file.
+ *
+ * Texture entries hold 'level_count' levels of 'internal_format' (GL_RGBA8 or
+ * a block-compressed format, see texload.hpp), each texture_level_size() bytes
+ * and padded to the alignment. Unless bundle_bottom_up is set, line 0 is at
+ * the top as in the image files. Blob entries (shader sources) hold 'size'
+ * bytes, without a terminating zero.
+ */
+
+#ifndef ASSETBUNDLE_HPP
+#define ASSETBUNDLE_HPP
+
+#include <cstdint>
+
+static const char bundle_magic[4] = { 'T', 'B', 'A', 'B' };
+static const uint32_t bundle_version = 1;
+static const uint64_t bundle_alignment = 16;
+
+enum bundle_kind {
+    bundle_blob = 0,
+    bundle_texture = 1
+};
+
+enum bundle_flags {
+    bundle_bottom_up = 1
+};
+
+struct bundle_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t reserved;
+};
+
+struct bundle_entry {
+    char name[88];              // zero terminated
+    uint32_t kind;
+    uint32_t internal_format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+    uint32_t flags;
+    uint64_t offset;            // from the start of the file
+    uint64_t size;              // from 'offset' to the end of the last level
+};
+
+static_assert(sizeof(bundle_header) == 16, "bundle_header must be packed");
+static_assert(sizeof(bundle_entry) == 128, "bundle_entry must be packed");
+
+inline uint64_t bundle_align(uint64_t offset)
+{
+    return (offset + bundle_alignment - 1) & ~(bundle_alignment - 1);
+}
+
+#endif
@@ -6,6 +6,9 @@
  */
 
 #include <vector>
+#include <map>
+#include <unordered_map>
+#include <utility>
 #include <cassert>
 #include <cstddef>
 
@@ -184,6 +187,197 @@ void geom_sphere(
     }
 }
 
+// Orients a triangle of a mesh around the origin counterclockwise as seen from outside.
+static void push_outward_triangle(const std::vector<vec3>& positions, std::vector<unsigned int>& indices,
+        unsigned int a, unsigned int b, unsigned int c)
+{
+    const vec3& pa = positions[a];
+    const vec3& pb = positions[b];
+    const vec3& pc = positions[c];
+    bool outward = dot(cross(pb - pa, pc - pa), pa + pb + pc) > 0.0f;
+    indices.push_back(a);
+    indices.push_back(outward ? b : c);
+    indices.push_back(outward ? c : b);
+}
+
+// Assigns longitude/latitude texture coordinates to unit sphere positions. Vertices
+// of triangles that cross the seam at s = 0 are duplicated with s + 1, and every
+// triangle at a pole gets its own copy of the pole vertex with the mean s of the
+// other two vertices, so no triangle stretches across the texture.
+static void sphere_texcoords(
+        std::vector<vec3>& positions,
+        std::vector<vec3>& normals,
+        std::vector<vec2>& texcoords,
+        std::vector<unsigned int>& indices)
+{
+    texcoords.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); i++) {
+        const vec3& p = positions[i];
+        float s = atan(p.z, p.x) / (2.0f * pi<float>());
+        if (s < 0.0f)
+            s += 1.0f;
+        float t = 0.5f - asin(clamp(p.y, -1.0f, 1.0f)) / pi<float>();
+        texcoords[i] = vec2(s, t);
+    }
+
+    std::vector<unsigned int> seam_copy(positions.size(), 0);
+    auto duplicate = [&](unsigned int v, vec2 texcoord) {
+        positions.push_back(positions[v]);
+        normals.push_back(normals[v]);
+        texcoords.push_back(texcoord);
+        return static_cast<unsigned int>(positions.size() - 1);
+    };
+    auto is_pole = [&](unsigned int v) {
+        return abs(positions[v].y) > 1.0f - 1e-6f;
+    };
+
+    for (size_t t = 0; t < indices.size(); t += 3) {
+        unsigned int* v = &indices[t];
+        float min_s = 1.0f, max_s = 0.0f;
+        for (int j = 0; j < 3; j++) {
+            if (is_pole(v[j]))
+                continue;
+            min_s = min(min_s, texcoords[v[j]].s);
+            max_s = max(max_s, texcoords[v[j]].s);
+        }
+        if (max_s - min_s > 0.5f) {
+            for (int j = 0; j < 3; j++) {
+                if (is_pole(v[j]) || texcoords[v[j]].s >= 0.5f)
+                    continue;
+                if (seam_copy[v[j]] == 0)
+                    seam_copy[v[j]] = duplicate(v[j], texcoords[v[j]] + vec2(1.0f, 0.0f));
+                v[j] = seam_copy[v[j]];
+            }
+        }
+        for (int j = 0; j < 3; j++) {
+            if (!is_pole(v[j]))
+                continue;
+            float s = 0.5f * (texcoords[v[(j + 1) % 3]].s + texcoords[v[(j + 2) % 3]].s);
+            v[j] = duplicate(v[j], vec2(s, texcoords[v[j]].t));
+        }
+    }
+}
+
+void geom_icosphere(
+        std::vector<vec3>& positions,
+        std::vector<vec3>& normals,
+        std::vector<vec2>& texcoords,
+        std::vector<unsigned int>& indices,
+        int subdivisions)
+{
+    assert(subdivisions >= 0);
+
+    positions.clear();
+    normals.clear();
+    texcoords.clear();
+    indices.clear();
+
+    // Icosahedron with a vertex at each pole and two rings of five in between.
+    float ring_lat = atan(0.5f);
+    positions.push_back(vec3(0.0f, +1.0f, 0.0f));
+    for (int r = 0; r < 2; r++) {
+        float lat = (r == 0 ? ring_lat : -ring_lat);
+        for (int k = 0; k < 5; k++) {
+            float lon = (k + 0.5f * r) * 2.0f * pi<float>() / 5.0f;
+            positions.push_back(vec3(cos(lat) * cos(lon), sin(lat), cos(lat) * sin(lon)));
+        }
+    }
+    positions.push_back(vec3(0.0f, -1.0f, 0.0f));
+    for (unsigned int k = 0; k < 5; k++) {
+        unsigned int upper = 1 + k, upper_next = 1 + (k + 1) % 5;
+        unsigned int lower = 6 + k, lower_next = 6 + (k + 1) % 5;
+        push_outward_triangle(positions, indices, 0, upper, upper_next);
+        push_outward_triangle(positions, indices, upper, lower, upper_next);
+        push_outward_triangle(positions, indices, upper_next, lower, lower_next);
+        push_outward_triangle(positions, indices, 11, lower_next, lower);
+    }
+
+    // Split every triangle into four, sharing the new vertex of each edge.
+    for (int level = 0; level < subdivisions; level++) {
+        std::map<std::pair<unsigned int, unsigned int>, unsigned int> midpoints;
+        auto midpoint = [&](unsigned int a, unsigned int b) {
+            std::pair<unsigned int, unsigned int> edge(min(a, b), max(a, b));
+            auto it = midpoints.find(edge);
+            if (it != midpoints.end())
+                return it->second;
+            positions.push_back(normalize(positions[a] + positions[b]));
+            unsigned int m = static_cast<unsigned int>(positions.size() - 1);
+            midpoints[edge] = m;
+            return m;
+        };
+        std::vector<unsigned int> coarse;
+        coarse.swap(indices);
+        indices.reserve(coarse.size() * 4);
+        for (size_t t = 0; t < coarse.size(); t += 3) {
+            unsigned int a = coarse[t], b = coarse[t + 1], c = coarse[t + 2];
+            unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+            unsigned int split[] = { a, ab, ca,   ab, b, bc,   ca, bc, c,   ab, bc, ca };
+            indices.insert(indices.end(), split, split + 12);
+        }
+    }
+
+    normals = positions;
+    sphere_texcoords(positions, normals, texcoords, indices);
+}
+
+void geom_cubesphere(
+        std::vector<vec3>& positions,
+        std::vector<vec3>& normals,
+        std::vector<vec2>& texcoords,
+        std::vector<unsigned int>& indices,
+        int subdivisions)
+{
+    assert(subdivisions >= 2);
+    assert(subdivisions % 2 == 0);
+
+    positions.clear();
+    normals.clear();
+    texcoords.clear();
+    indices.clear();
+
+    // Grid points on the cube surface are identified by their integer coordinates
+    // in [0, subdivisions]^3, so the faces share their edge vertices.
+    const int n = subdivisions;
+    std::map<int, unsigned int> lattice;
+    auto vertex = [&](ivec3 l) {
+        int key = (l.x * (n + 1) + l.y) * (n + 1) + l.z;
+        auto it = lattice.find(key);
+        if (it != lattice.end())
+            return it->second;
+        // Spread the points evenly over the sphere instead of normalizing the cube.
+        vec3 p = vec3(l) * (2.0f / n) - 1.0f;
+        vec3 p2 = p * p;
+        positions.push_back(normalize(vec3(
+                        p.x * sqrt(1.0f - p2.y / 2.0f - p2.z / 2.0f + p2.y * p2.z / 3.0f),
+                        p.y * sqrt(1.0f - p2.z / 2.0f - p2.x / 2.0f + p2.z * p2.x / 3.0f),
+                        p.z * sqrt(1.0f - p2.x / 2.0f - p2.y / 2.0f + p2.x * p2.y / 3.0f))));
+        unsigned int v = static_cast<unsigned int>(positions.size() - 1);
+        lattice[key] = v;
+        return v;
+    };
+
+    for (int axis = 0; axis < 3; axis++) {
+        for (int side = 0; side <= n; side += n) {
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j < n; j++) {
+                    ivec3 l[4];
+                    for (int c = 0; c < 4; c++) {
+                        l[c][axis] = side;
+                        l[c][(axis + 1) % 3] = i + (c == 1 || c == 2);
+                        l[c][(axis + 2) % 3] = j + (c >= 2);
+                    }
+                    unsigned int v[4] = { vertex(l[0]), vertex(l[1]), vertex(l[2]), vertex(l[3]) };
+                    push_outward_triangle(positions, indices, v[0], v[1], v[2]);
+                    push_outward_triangle(positions, indices, v[0], v[2], v[3]);
+                }
+            }
+        }
+    }
+
+    normals = positions;
+    sphere_texcoords(positions, normals, texcoords, indices);
+}
+
 void geom_cylinder(
         std::vector<vec3>& positions,
         std::vector<vec3>& normals,
@@ -6238,52 +6432,156 @@ void geom_teapot(
 std::vector<unsigned int> create_adjacency(const std::vector<unsigned int>& indices)
 {
     assert(indices.size() % 3 == 0);
-    std::vector<unsigned int> indices_with_adjacency(indices.size() / 3 * 6);
-    for (size_t t = 0; t < indices.size() / 3; t++) {
+    const size_t triangle_count = indices.size() / 3;
+
+    // Directed edge i runs from indices[i] to the next vertex of its triangle,
+    // so edge 3t+e is the edge of triangle t opposite to vertex (e+2)%3. The edges
+    // with the same start and end vertex are chained in index order.
+    const unsigned int none = ~0u;
+    std::vector<unsigned int> next_edge(indices.size(), none);
+    std::unordered_map<unsigned long long, std::pair<unsigned int, unsigned int>> edges; // first, last
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+        size_t t = i / 3;
+        unsigned long long key = (static_cast<unsigned long long>(indices[i]) << 32)
+            | indices[3 * t + (i + 1) % 3];
+        unsigned int edge = static_cast<unsigned int>(i);
+        auto inserted = edges.emplace(key, std::make_pair(edge, edge));
+        if (!inserted.second) {
+            next_edge[inserted.first->second.second] = edge;
+            inserted.first->second.second = edge;
+        }
+    }
+
+    std::vector<unsigned int> indices_with_adjacency(triangle_count * 6);
+    for (size_t t = 0; t < triangle_count; t++) {
         unsigned int v[3] = { indices[3 * t + 0], indices[3 * t + 1], indices[3 * t + 2] };
-        unsigned int nv[3] = { v[2], v[0], v[1] }; // neighbor triangle vertices for edges 0, 1, 2
-        for (size_t nt = 0; nt < indices.size() / 3; nt++) {
-            if (nt == t)
+        for (int e = 0; e < 3; e++) {
+            unsigned int a = v[e], b = v[(e + 1) % 3], opposite = v[(e + 2) % 3];
+            // Neighbor triangles must have the same orientation as the current
+            // triangle, so they contain the edge from b to a. As before, the first
+            // such triangle wins unless its third vertex is our own; only the first
+            // matching edge of each triangle counts.
+            unsigned int neighbor = opposite;
+            auto it = edges.find((static_cast<unsigned long long>(b) << 32) | a);
+            size_t checked_triangle = t;
+            for (unsigned int i = (it == edges.end() ? none : it->second.first); i != none; i = next_edge[i]) {
+                size_t nt = i / 3;
+                if (nt == t || nt == checked_triangle)
+                    continue;
+                checked_triangle = nt;
+                unsigned int candidate = indices[3 * nt + (i + 2) % 3];
+                if (candidate != opposite) {
+                    neighbor = candidate;
+                    break;
+                }
+            }
+            indices_with_adjacency[6 * t + 2 * e + 0] = a;
+            indices_with_adjacency[6 * t + 2 * e + 1] = neighbor;
+        }
+    }
+    return indices_with_adjacency;
+}
+
+std::vector<unsigned int> optimize_vertex_cache(const std::vector<unsigned int>& indices,
+        size_t vertex_count, int cache_size)
+{
+    assert(indices.size() % 3 == 0);
+    assert(cache_size >= 3);
+    const size_t triangle_count = indices.size() / 3;
+
+    // Triangles around each vertex, as offsets into one array.
+    std::vector<unsigned int> live(vertex_count, 0);
+    for (size_t i = 0; i < indices.size(); i++)
+        live[indices[i]]++;
+    std::vector<size_t> first(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; v++)
+        first[v + 1] = first[v] + live[v];
+    std::vector<unsigned int> adjacent(indices.size());
+    std::vector<size_t> fill(first.begin(), first.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+        adjacent[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+    // Tipsify (Sander, Nehab, Barczak 2007): emit all triangles around a fanning
+    // vertex, then continue with the vertex that was used most recently but
+    // will still be in the cache after its remaining triangles are emitted.
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    std::vector<int> time_stamp(vertex_count, 0);
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<unsigned int> dead_end;
+    std::vector<unsigned int> candidates;
+    int time = cache_size + 1;
+    size_t cursor = 0;
+    long long fanning = (vertex_count > 0 ? 0 : -1);
+    while (fanning >= 0) {
+        candidates.clear();
+        for (size_t a = first[fanning]; a < first[fanning + 1]; a++) {
+            unsigned int t = adjacent[a];
+            if (emitted[t])
+                continue;
+            for (int j = 0; j < 3; j++) {
+                unsigned int v = indices[3 * t + j];
+                result.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - time_stamp[v] > cache_size)
+                    time_stamp[v] = time++;
+            }
+            emitted[t] = true;
+        }
+
+        fanning = -1;
+        int best = -1;
+        for (unsigned int v : candidates) {
+            if (live[v] == 0)
                 continue;
-            unsigned int test_nv[3] = { indices[3 * nt + 0], indices[3 * nt + 1], indices[3 * nt + 2] };
-            // Test edges. Neighbor triangles must have the same orientation as the
-            // current triangle, so we only have to check one edge direction.
-            // edge 0
-            if (nv[0] == v[2]) {
-                if (v[0] == test_nv[1] && v[1] == test_nv[0])
-                    nv[0] = test_nv[2];
-                else if (v[0] == test_nv[2] && v[1] == test_nv[1])
-                    nv[0] = test_nv[0];
-                else if (v[0] == test_nv[0] && v[1] == test_nv[2])
-                    nv[0] = test_nv[1];
+            int priority = 0;
+            if (time - time_stamp[v] + 2 * static_cast<int>(live[v]) <= cache_size)
+                priority = time - time_stamp[v];
+            if (priority > best) {
+                best = priority;
+                fanning = v;
             }
-            // edge 1
-            if (nv[1] == v[0]) {
-                if (v[1] == test_nv[1] && v[2] == test_nv[0])
-                    nv[1] = test_nv[2];
-                else if (v[1] == test_nv[2] && v[2] == test_nv[1])
-                    nv[1] = test_nv[0];
-                else if (v[1] == test_nv[0] && v[2] == test_nv[2])
-                    nv[1] = test_nv[1];
+        }
+        if (fanning < 0) {
+            while (!dead_end.empty() && fanning < 0) {
+                unsigned int v = dead_end.back();
+                dead_end.pop_back();
+                if (live[v] > 0)
+                    fanning = v;
             }
-            // edge 2
-            if (nv[2] == v[1]) {
-                if (v[2] == test_nv[1] && v[0] == test_nv[0])
-                    nv[2] = test_nv[2];
-                else if (v[2] == test_nv[2] && v[0] == test_nv[1])
-                    nv[2] = test_nv[0];
-                else if (v[2] == test_nv[0] && v[0] == test_nv[2])
-                    nv[2] = test_nv[1];
+            while (fanning < 0 && cursor < vertex_count) {
+                if (live[cursor] > 0)
+                    fanning = static_cast<long long>(cursor);
+                else
+                    cursor++;
             }
-            if (nv[0] != v[2] && nv[1] != v[0] && nv[2] != v[1])
-                break;
         }
-        indices_with_adjacency[6 * t + 0] = v[0];
-        indices_with_adjacency[6 * t + 1] = nv[0];
-        indices_with_adjacency[6 * t + 2] = v[1];
-        indices_with_adjacency[6 * t + 3] = nv[1];
-        indices_with_adjacency[6 * t + 4] = v[2];
-        indices_with_adjacency[6 * t + 5] = nv[2];
     }
-    return indices_with_adjacency;
+    return result;
+}
+
+float vertex_cache_acmr(const std::vector<unsigned int>& indices, int cache_size)
+{
+    assert(indices.size() % 3 == 0);
+    if (indices.empty())
+        return 0.0f;
+
+    // FIFO cache as in most hardware: a hit does not refresh the entry.
+    std::vector<unsigned int> cache(cache_size, ~0u);
+    size_t next = 0;
+    size_t misses = 0;
+    for (size_t i = 0; i < indices.size(); i++) {
+        bool hit = false;
+        for (int c = 0; c < cache_size && !hit; c++)
+            hit = (cache[c] == indices[i]);
+        if (!hit) {
+            cache[next] = indices[i];
+            next = (next + 1) % cache_size;
+            misses++;
+        }
+    }
+    return static_cast<float>(misses) / (indices.size() / 3);
 }
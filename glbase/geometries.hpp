@@ -46,6 +46,31 @@ void geom_sphere(
         std::vector<unsigned int>& indices,
         int slices = 40, int stacks = 20);
 
+/* Spheres made of evenly sized triangles, for the same shading quality with fewer
+ * vertices than geom_sphere(), which crowds its vertices at the poles.
+ * geom_icosphere() splits the 20 triangles of an icosahedron into four
+ * 'subdivisions' times; geom_cubesphere() splits each face of a cube into
+ * subdivisions x subdivisions cells (an even number, so that the poles are
+ * vertices) and spreads them evenly over the sphere. Both put a vertex on each
+ * pole (+y and -y). The texture coordinates are those of an equirectangular map:
+ * s = atan(z, x) / 2pi in [0, 1] and t from 0 at +y to 1 at -y. Triangles across
+ * the seam at s = 0 get copies of their vertices with s > 1, so textures need
+ * GL_REPEAT in s, and each triangle at a pole gets its own pole vertex. */
+
+void geom_icosphere(
+        std::vector<glm::vec3>& positions,
+        std::vector<glm::vec3>& normals,
+        std::vector<glm::vec2>& texcoords,
+        std::vector<unsigned int>& indices,
+        int subdivisions = 3);
+
+void geom_cubesphere(
+        std::vector<glm::vec3>& positions,
+        std::vector<glm::vec3>& normals,
+        std::vector<glm::vec2>& texcoords,
+        std::vector<unsigned int>& indices,
+        int subdivisions = 16);
+
 void geom_cylinder(
         std::vector<glm::vec3>& positions,
         std::vector<glm::vec3>& normals,
@@ -77,8 +102,21 @@ void geom_teapot(
  * that provides GL_TRIANGLES_ADJACENCY. This is useful for geometry shaders.
  * If a neighboring triangle is not found for an edge of a given triangle, the
  * neighbor for that edge will be set to the triangle itself, only in opposite direction.
- * WARNING: the current implementation is O(n²). Only use once on initialization, and
- * don't use with larger models. */
+ * The edges are looked up in a hash map, so this runs in linear time. */
 std::vector<unsigned int> create_adjacency(const std::vector<unsigned int>& indices);
 
+/* Reorders the triangles of a GL_TRIANGLES index list for the post-transform
+ * vertex cache of the GPU with the Tipsify algorithm, which runs in linear time.
+ * 'cache_size' is the number of vertices the cache is assumed to hold. Meshes
+ * that are closed and convex, like the spheres above, cannot overdraw themselves
+ * with back face culling, so the order is only optimized for the cache. */
+std::vector<unsigned int> optimize_vertex_cache(const std::vector<unsigned int>& indices,
+        size_t vertex_count, int cache_size = 16);
+
+/* Returns the average cache miss ratio of a GL_TRIANGLES index list: the number of
+ * vertices transformed per triangle with a FIFO cache of 'cache_size' vertices.
+ * It is 3 without any reuse, about 1 for a mesh drawn in rows and approaches 0.5
+ * for a well ordered large mesh. */
+float vertex_cache_acmr(const std::vector<unsigned int>& indices, int cache_size = 16);
+
 #endif
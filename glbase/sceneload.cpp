@@ -0,0 +1,519 @@
+/*
+ * Scene description readers and writer, see sceneload.hpp.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+#include "sceneload.hpp"
+
+static const char scene_magic[4] = { 'T', 'B', 'S', 'C' };
+static const uint32_t scene_version = 1;
+static const uint32_t scene_no_string = 0xffffffffu;
+
+enum scene_record_flags {
+    scene_flag_random_start_angle = 1,
+    scene_flag_ring = 2
+};
+
+struct scene_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t body_count;
+    uint32_t string_bytes;
+};
+
+struct scene_record {
+    uint32_t type;
+    int32_t parent;
+    float radius;
+    float distance;
+    float hours_per_day;
+    uint32_t days_per_year;
+    float start_angle;
+    float inclination;
+    uint32_t name;              // offsets into the string table, or scene_no_string
+    uint32_t texture;
+    uint32_t clouds;
+    uint32_t ring_texture;
+    float ring_inner;
+    float ring_outer;
+    float ring_tilt;
+    uint32_t flags;
+};
+
+static_assert(sizeof(scene_header) == 16, "scene_header must be packed");
+static_assert(sizeof(scene_record) == 64, "scene_record must be packed");
+
+void scene_body::reset()
+{
+    name.clear();
+    parent = -1;
+    type = scene_planet;
+    radius = 1.0f;
+    distance = 10.0f;
+    hours_per_day = 24.0f;
+    days_per_year = 365;
+    random_start_angle = true;
+    start_angle = 0.0f;
+    inclination = 0.0f;
+    texture = ":/res/images/earth.bmp";
+    clouds.clear();
+    has_ring = false;
+    ring_inner = 0.0f;
+    ring_outer = 0.0f;
+    ring_tilt = 0.0f;
+    ring_texture = ":/res/images/ring.bmp";
+}
+
+bool read_scene(const char* data, size_t size, const scene_body_function& body, std::string& error)
+{
+    if (size >= 4 && std::memcmp(data, scene_magic, 4) == 0)
+        return read_scene_binary(data, size, body, error);
+    return read_scene_json(data, size, body, error);
+}
+
+/* A pull parser for the subset of JSON used by scenes. Values are read
+ * directly into the scene_body, without building a document. */
+class json_reader {
+public:
+    json_reader(const char* data, size_t size) : _begin(data), _p(data), _end(data + size) {}
+
+    std::string error;
+
+    bool fail(const char* message)
+    {
+        if (error.empty()) {
+            int line = 1;
+            for (const char* q = _begin; q < _p && q < _end; q++)
+                line += (*q == '\n');
+            error = "line " + std::to_string(line) + ": " + message;
+        }
+        return false;
+    }
+
+    char peek()
+    {
+        while (_p < _end && (*_p == ' ' || *_p == '\t' || *_p == '\n' || *_p == '\r'))
+            _p++;
+        return _p < _end ? *_p : '\0';
+    }
+
+    bool accept(char c)
+    {
+        if (peek() != c)
+            return false;
+        _p++;
+        return true;
+    }
+
+    bool expect(char c)
+    {
+        if (accept(c))
+            return true;
+        char message[32];
+        std::snprintf(message, sizeof(message), "expected '%c'", c);
+        return fail(message);
+    }
+
+    bool string(std::string& s)
+    {
+        s.clear();
+        if (!expect('"'))
+            return false;
+        while (_p < _end && *_p != '"') {
+            if (*_p != '\\') {
+                s.push_back(*_p++);
+                continue;
+            }
+            if (++_p >= _end)
+                break;
+            char c = *_p++;
+            switch (c) {
+            case 'n': s.push_back('\n'); break;
+            case 't': s.push_back('\t'); break;
+            case 'r': s.push_back('\r'); break;
+            case 'b': s.push_back('\b'); break;
+            case 'f': s.push_back('\f'); break;
+            case 'u': {
+                if (_end - _p < 4)
+                    return fail("truncated \\u escape");
+                char hex[5] = { _p[0], _p[1], _p[2], _p[3], '\0' };
+                _p += 4;
+                unsigned long u = std::strtoul(hex, nullptr, 16);
+                // Surrogate pairs are not combined; names and paths do not need them.
+                if (u < 0x80) {
+                    s.push_back(static_cast<char>(u));
+                } else if (u < 0x800) {
+                    s.push_back(static_cast<char>(0xc0 | (u >> 6)));
+                    s.push_back(static_cast<char>(0x80 | (u & 0x3f)));
+                } else {
+                    s.push_back(static_cast<char>(0xe0 | (u >> 12)));
+                    s.push_back(static_cast<char>(0x80 | ((u >> 6) & 0x3f)));
+                    s.push_back(static_cast<char>(0x80 | (u & 0x3f)));
+                }
+                break;
+            }
+            default: s.push_back(c); break;
+            }
+        }
+        if (_p >= _end)
+            return fail("unterminated string");
+        _p++;
+        return true;
+    }
+
+    bool number(double& value)
+    {
+        peek();
+        char buffer[64];
+        size_t n = 0;
+        while (_p < _end && n + 1 < sizeof(buffer) && std::strchr("+-.0123456789eE", *_p))
+            buffer[n++] = *_p++;
+        buffer[n] = '\0';
+        char* number_end;
+        value = std::strtod(buffer, &number_end);
+        if (n == 0 || *number_end != '\0')
+            return fail("expected a number");
+        return true;
+    }
+
+    bool number(float& value)
+    {
+        double d;
+        bool ok = number(d);
+        value = static_cast<float>(d);
+        return ok;
+    }
+
+    bool number(unsigned int& value)
+    {
+        double d;
+        if (!number(d))
+            return false;
+        if (d < 0.0 || d > 4294967295.0)
+            return fail("number out of range");
+        value = static_cast<unsigned int>(d);
+        return true;
+    }
+
+    bool literal(const char* word)
+    {
+        size_t n = std::strlen(word);
+        if (static_cast<size_t>(_end - _p) < n || std::strncmp(_p, word, n) != 0)
+            return fail("invalid value");
+        _p += n;
+        return true;
+    }
+
+    bool skip_value()
+    {
+        std::string s;
+        double d;
+        switch (peek()) {
+        case '"':
+            return string(s);
+        case '{':
+            _p++;
+            if (accept('}'))
+                return true;
+            do {
+                if (!string(s) || !expect(':') || !skip_value())
+                    return false;
+            } while (accept(','));
+            return expect('}');
+        case '[':
+            _p++;
+            if (accept(']'))
+                return true;
+            do {
+                if (!skip_value())
+                    return false;
+            } while (accept(','));
+            return expect(']');
+        case 't':
+            return literal("true");
+        case 'f':
+            return literal("false");
+        case 'n':
+            return literal("null");
+        default:
+            return number(d);
+        }
+    }
+
+    bool at_end()
+    {
+        return peek() == '\0' && _p >= _end;
+    }
+
+private:
+    const char* _begin;
+    const char* _p;
+    const char* _end;
+};
+
+static bool read_json_ring(json_reader& json, scene_body& body, std::string& key)
+{
+    body.has_ring = true;
+    if (!json.expect('{'))
+        return false;
+    if (json.accept('}'))
+        return true;
+    do {
+        if (!json.string(key) || !json.expect(':'))
+            return false;
+        bool ok = (key == "inner" ? json.number(body.ring_inner)
+                : key == "outer" ? json.number(body.ring_outer)
+                : key == "tilt" ? json.number(body.ring_tilt)
+                : key == "texture" ? json.string(body.ring_texture)
+                : json.skip_value());
+        if (!ok)
+            return false;
+    } while (json.accept(','));
+    return json.expect('}');
+}
+
+static bool read_json_body(json_reader& json, scene_body& body, std::string& parent, std::string& key)
+{
+    body.reset();
+    parent.clear();
+    if (!json.expect('{'))
+        return false;
+    if (json.accept('}'))
+        return true;
+    do {
+        if (!json.string(key) || !json.expect(':'))
+            return false;
+        bool ok;
+        if (key == "name") {
+            ok = json.string(body.name);
+        } else if (key == "type") {
+            std::string type;
+            ok = json.string(type);
+            if (ok && type == "planet")
+                body.type = scene_planet;
+            else if (ok && type == "sun")
+                body.type = scene_sun;
+            else if (ok && type == "deathstar")
+                body.type = scene_death_star;
+            else if (ok)
+                return json.fail("unknown body type");
+        } else if (key == "parent") {
+            ok = json.string(parent);
+        } else if (key == "radius") {
+            ok = json.number(body.radius);
+        } else if (key == "distance") {
+            ok = json.number(body.distance);
+        } else if (key == "hoursPerDay") {
+            ok = json.number(body.hours_per_day);
+        } else if (key == "daysPerYear") {
+            ok = json.number(body.days_per_year);
+        } else if (key == "startAngle") {
+            ok = json.number(body.start_angle);
+            body.random_start_angle = false;
+        } else if (key == "inclination") {
+            ok = json.number(body.inclination);
+        } else if (key == "texture") {
+            ok = json.string(body.texture);
+        } else if (key == "clouds") {
+            ok = json.string(body.clouds);
+        } else if (key == "ring") {
+            ok = read_json_ring(json, body, key);
+        } else {
+            ok = json.skip_value();
+        }
+        if (!ok)
+            return false;
+    } while (json.accept(','));
+    return json.expect('}');
+}
+
+bool read_scene_json(const char* data, size_t size, const scene_body_function& body, std::string& error)
+{
+    json_reader json(data, size);
+    scene_body b;
+    std::string key, parent;
+    std::unordered_map<std::string, int> indices;
+    bool ok = json.expect('{');
+    bool first = true;
+    while (ok && !json.accept('}')) {
+        if (!first)
+            ok = json.expect(',');
+        first = false;
+        ok = ok && json.string(key) && json.expect(':');
+        if (!ok)
+            break;
+        if (key == "version") {
+            unsigned int version = 0;
+            ok = json.number(version) && (version == scene_version || json.fail("unsupported version"));
+        } else if (key == "bodies") {
+            ok = json.expect('[');
+            if (ok && !json.accept(']')) {
+                do {
+                    ok = read_json_body(json, b, parent, key);
+                    if (!ok)
+                        break;
+                    int index = static_cast<int>(indices.size());
+                    if (b.name.empty()) {
+                        ok = json.fail("body without a name");
+                    } else if (!indices.insert(std::make_pair(b.name, index)).second) {
+                        ok = json.fail(("duplicate body " + b.name).c_str());
+                    } else if (parent.empty() != (index == 0)) {
+                        ok = json.fail(index == 0 ? "the first body must not have a parent"
+                                : ("body " + b.name + " has no parent").c_str());
+                    } else if (!parent.empty()) {
+                        std::unordered_map<std::string, int>::const_iterator it = indices.find(parent);
+                        if (it == indices.end() || it->second == index)
+                            ok = json.fail(("unknown parent " + parent + ", parents must come first").c_str());
+                        else
+                            b.parent = it->second;
+                    }
+                    ok = ok && (body(b) || json.fail("stopped by the caller"));
+                } while (ok && json.accept(','));
+                ok = ok && json.expect(']');
+            }
+        } else {
+            ok = json.skip_value();
+        }
+    }
+    if (ok && !json.at_end())
+        ok = json.fail("trailing data");
+    if (ok && indices.empty())
+        ok = json.fail("no bodies");
+    error = json.error;
+    return ok;
+}
+
+static bool scene_string(const char* strings, uint32_t string_bytes, uint32_t offset, std::string& s)
+{
+    s.clear();
+    if (offset == scene_no_string)
+        return true;
+    if (offset >= string_bytes)
+        return false;
+    const char* begin = strings + offset;
+    const char* end = static_cast<const char*>(std::memchr(begin, '\0', string_bytes - offset));
+    if (!end)
+        return false;
+    s.assign(begin, end);
+    return true;
+}
+
+bool read_scene_binary(const char* data, size_t size, const scene_body_function& body, std::string& error)
+{
+    scene_header header;
+    if (size < sizeof(header)) {
+        error = "truncated header";
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, scene_magic, 4) != 0 || header.version != scene_version) {
+        error = "not a scene file of version 1";
+        return false;
+    }
+    if (header.body_count == 0
+            || size < sizeof(header) + uint64_t(header.body_count) * sizeof(scene_record) + header.string_bytes) {
+        error = "truncated file";
+        return false;
+    }
+
+    const char* records = data + sizeof(header);
+    const char* strings = records + size_t(header.body_count) * sizeof(scene_record);
+    scene_body b;
+    for (uint32_t i = 0; i < header.body_count; i++) {
+        scene_record r;
+        std::memcpy(&r, records + size_t(i) * sizeof(r), sizeof(r));
+        if ((i == 0) != (r.parent < 0) || r.parent >= static_cast<int32_t>(i)) {
+            error = "body " + std::to_string(i) + ": invalid parent";
+            return false;
+        }
+        if (r.type != scene_planet && r.type != scene_sun && r.type != scene_death_star) {
+            error = "body " + std::to_string(i) + ": unknown body type";
+            return false;
+        }
+        b.parent = r.parent;
+        b.type = r.type;
+        b.radius = r.radius;
+        b.distance = r.distance;
+        b.hours_per_day = r.hours_per_day;
+        b.days_per_year = r.days_per_year;
+        b.random_start_angle = (r.flags & scene_flag_random_start_angle) != 0;
+        b.start_angle = r.start_angle;
+        b.inclination = r.inclination;
+        b.has_ring = (r.flags & scene_flag_ring) != 0;
+        b.ring_inner = r.ring_inner;
+        b.ring_outer = r.ring_outer;
+        b.ring_tilt = r.ring_tilt;
+        if (!scene_string(strings, header.string_bytes, r.name, b.name)
+                || !scene_string(strings, header.string_bytes, r.texture, b.texture)
+                || !scene_string(strings, header.string_bytes, r.clouds, b.clouds)
+                || !scene_string(strings, header.string_bytes, r.ring_texture, b.ring_texture)) {
+            error = "body " + std::to_string(i) + ": invalid string";
+            return false;
+        }
+        if (!body(b)) {
+            error = "stopped by the caller";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool write_scene_binary(const std::string& filename, const std::vector<scene_body>& bodies)
+{
+    std::string strings;
+    std::map<std::string, uint32_t> offsets;
+    auto add_string = [&](const std::string& s) -> uint32_t {
+        if (s.empty())
+            return scene_no_string;
+        std::map<std::string, uint32_t>::const_iterator it = offsets.find(s);
+        if (it != offsets.end())
+            return it->second;
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.append(s.c_str(), s.size() + 1);
+        offsets[s] = offset;
+        return offset;
+    };
+
+    std::vector<scene_record> records(bodies.size());
+    for (size_t i = 0; i < bodies.size(); i++) {
+        const scene_body& b = bodies[i];
+        scene_record& r = records[i];
+        r.type = b.type;
+        r.parent = b.parent;
+        r.radius = b.radius;
+        r.distance = b.distance;
+        r.hours_per_day = b.hours_per_day;
+        r.days_per_year = b.days_per_year;
+        r.start_angle = b.start_angle;
+        r.inclination = b.inclination;
+        r.name = add_string(b.name);
+        r.texture = add_string(b.texture);
+        r.clouds = add_string(b.clouds);
+        r.ring_texture = add_string(b.has_ring ? b.ring_texture : std::string());
+        r.ring_inner = b.ring_inner;
+        r.ring_outer = b.ring_outer;
+        r.ring_tilt = b.ring_tilt;
+        r.flags = (b.random_start_angle ? scene_flag_random_start_angle : 0) | (b.has_ring ? scene_flag_ring : 0);
+    }
+
+    scene_header header;
+    std::memcpy(header.magic, scene_magic, 4);
+    header.version = scene_version;
+    header.body_count = static_cast<uint32_t>(records.size());
+    header.string_bytes = static_cast<uint32_t>(strings.size());
+
+    FILE* f = std::fopen(filename.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1
+        && (records.empty() || std::fwrite(&records[0], sizeof(scene_record), records.size(), f) == records.size())
+        && (strings.empty() || std::fwrite(strings.data(), strings.size(), 1, f) == 1);
+    ok = (std::fclose(f) == 0) && ok;
+    return ok;
+}
@@ -0,0 +1,77 @@
+/*
+ * Scene descriptions: the bodies of a scene with their hierarchy, orbits,
+ * textures and rings.
+ *
+ * Two formats are supported. Text scenes are JSON for authoring:
+ *
+ *   { "version": 1,
+ *     "bodies": [
+ *       { "name": "Erde", "radius": 1.0, "distance": 0.0, "hoursPerDay": 24.0,
+ *         "daysPerYear": 1, "texture": ":/res/images/earth.bmp",
+ *         "clouds": ":/res/images/clouds.bmp", "startAngle": 0.0 },
+ *       { "name": "Sonne", "type": "sun", "parent": "Erde", ... },
+ *       { "name": "Saturn", "parent": "Sonne", ...,
+ *         "ring": { "inner": 0.54, "outer": 1.0, "texture": ":/res/images/ring.bmp", "tilt": 26.7 } } ] }
+ *
+ * The type is "planet" (the default), "sun" or "deathstar". Parents are
+ * named and must come before their children; the first body is the root
+ * and the only one without a parent. Missing numbers get the defaults of the
+ * Planet constructor, except that a missing startAngle is chosen randomly
+ * by the application. Unknown keys are skipped.
+ *
+ * Binary scenes are written by tools/scenepack for deployment: a 16-byte
+ * header ("TBSC", version, body count, string table size), one 64-byte
+ * record per body with the parent as an index, and a table of zero
+ * terminated strings shared by all records. All numbers are little endian.
+ *
+ * The readers do not build the whole scene in memory. They call 'body' once
+ * per body in file order, always with the same scene_body object, and stop
+ * when it returns false. read_scene() detects the format from the data.
+ * On failure, 'error' describes the problem.
+ */
+
+#ifndef SCENELOAD_H
+#define SCENELOAD_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+enum scene_body_type {
+    scene_planet = 0,
+    scene_sun = 1,
+    scene_death_star = 2
+};
+
+struct scene_body {
+    std::string name;
+    int parent;                 // index of the parent body, -1 for the root
+    unsigned int type;          // scene_body_type
+    float radius;
+    float distance;
+    float hours_per_day;
+    unsigned int days_per_year;
+    bool random_start_angle;
+    float start_angle;
+    float inclination;
+    std::string texture;        // empty for none
+    std::string clouds;         // empty for none
+    bool has_ring;
+    float ring_inner;
+    float ring_outer;
+    float ring_tilt;
+    std::string ring_texture;
+
+    /* Resets all fields to the defaults. */
+    void reset();
+};
+
+typedef std::function<bool(const scene_body& body)> scene_body_function;
+
+bool read_scene(const char* data, size_t size, const scene_body_function& body, std::string& error);
+bool read_scene_json(const char* data, size_t size, const scene_body_function& body, std::string& error);
+bool read_scene_binary(const char* data, size_t size, const scene_body_function& body, std::string& error);
+bool write_scene_binary(const std::string& filename, const std::vector<scene_body>& bodies);
+
+#endif
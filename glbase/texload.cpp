@@ -10,6 +10,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <cassert>
+#include <cstdint>
+#include <algorithm>
 
 #include <GL/glew.h>
 
@@ -81,6 +83,278 @@ bool save_png(GLenum target, const std::string& filename, bool reverse_y)
     return true;
 }
 
+static const unsigned char ktx_identifier[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+static size_t ktx_block_size(GLenum internal_format)
+{
+    switch (internal_format) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        return 8;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+size_t texture_level_size(GLenum internal_format, unsigned int width, unsigned int height)
+{
+    size_t block_size = ktx_block_size(internal_format);
+    if (block_size == 0)
+        return 4 * size_t(width) * height;
+    return block_size * ((width + 3) / 4) * ((height + 3) / 4);
+}
+
+bool read_ktx(const unsigned char* data, size_t size, ktx_image& image)
+{
+    if (size < 64 || std::memcmp(data, ktx_identifier, 12) != 0) {
+        fprintf(stderr, "ktx: not a KTX 1.1 file\n");
+        return false;
+    }
+    bool swap = (data[12] == 0x04);
+    auto u32 = [data, swap](size_t offset) -> uint32_t {
+        const unsigned char* p = data + offset;
+        return swap ? (uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | uint32_t(p[3]))
+                    : (uint32_t(p[3]) << 24 | uint32_t(p[2]) << 16 | uint32_t(p[1]) << 8 | uint32_t(p[0]));
+    };
+
+    uint32_t gl_type = u32(16);
+    uint32_t gl_format = u32(24);
+    uint32_t internal_format = u32(28);
+    uint32_t width = u32(36);
+    uint32_t height = u32(40);
+    uint32_t depth = u32(44);
+    uint32_t array_elements = u32(48);
+    uint32_t faces = u32(52);
+    uint32_t level_count = std::max(u32(56), uint32_t(1));
+    uint32_t key_value_bytes = u32(60);
+
+    bool uncompressed = (gl_type == GL_UNSIGNED_BYTE && gl_format == GL_RGBA && internal_format == GL_RGBA8);
+    if ((!uncompressed && (gl_type != 0 || ktx_block_size(internal_format) == 0))
+            || width == 0 || height == 0 || depth > 1 || array_elements != 0 || faces != 1) {
+        fprintf(stderr, "ktx: only 2D RGBA8, BC1, BC3 and BC7 textures are supported\n");
+        return false;
+    }
+
+    image.internal_format = internal_format;
+    image.levels.clear();
+    size_t offset = 64 + size_t(key_value_bytes);
+    for (uint32_t level = 0; level < level_count; level++) {
+        if (offset + 4 > size)
+            break;
+        size_t image_size = u32(offset);
+        offset += 4;
+        ktx_level l;
+        l.width = std::max(width >> level, uint32_t(1));
+        l.height = std::max(height >> level, uint32_t(1));
+        if (image_size != texture_level_size(internal_format, l.width, l.height) || offset + image_size > size)
+            break;
+        l.data.assign(data + offset, data + offset + image_size);
+        image.levels.push_back(std::move(l));
+        offset += (image_size + 3) & ~size_t(3);
+    }
+    if (image.levels.size() != level_count) {
+        fprintf(stderr, "ktx: truncated or inconsistent file\n");
+        return false;
+    }
+    return true;
+}
+
+bool read_ktx(const std::string& filename, ktx_image& image)
+{
+    std::vector<unsigned char> file;
+    lodepng::load_file(file, filename);
+    if (file.empty()) {
+        fprintf(stderr, "%s: cannot read file\n", filename.c_str());
+        return false;
+    }
+    return read_ktx(&file[0], file.size(), image);
+}
+
+bool write_ktx(const std::string& filename, const ktx_image& image)
+{
+    static const char orientation_key[] = "KTXorientation";
+    static const char orientation_value[] = "S=r,T=u";
+    uint32_t key_value_size = sizeof(orientation_key) + sizeof(orientation_value);
+    uint32_t key_value_bytes = 4 + ((key_value_size + 3) & ~uint32_t(3));
+
+    bool compressed = (ktx_block_size(image.internal_format) != 0);
+    uint32_t header[13] = {
+        0x04030201,
+        compressed ? 0u : uint32_t(GL_UNSIGNED_BYTE),
+        1,
+        compressed ? 0u : uint32_t(GL_RGBA),
+        uint32_t(image.internal_format),
+        compressed ? uint32_t(image.internal_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? GL_RGB : GL_RGBA)
+                   : uint32_t(GL_RGBA),
+        image.levels.empty() ? 0u : image.levels[0].width,
+        image.levels.empty() ? 0u : image.levels[0].height,
+        0, 0, 1,
+        uint32_t(image.levels.size()),
+        key_value_bytes
+    };
+
+    FILE* f = std::fopen(filename.c_str(), "wb");
+    if (!f)
+        return false;
+    // The header is written in host byte order; the endianness field tells readers which one.
+    const unsigned char padding[4] = { 0, 0, 0, 0 };
+    bool ok = std::fwrite(ktx_identifier, 12, 1, f) == 1
+        && std::fwrite(header, sizeof(header), 1, f) == 1
+        && std::fwrite(&key_value_size, 4, 1, f) == 1
+        && std::fwrite(orientation_key, sizeof(orientation_key), 1, f) == 1
+        && std::fwrite(orientation_value, sizeof(orientation_value), 1, f) == 1
+        && std::fwrite(padding, key_value_bytes - 4 - key_value_size, 1, f) <= 1;
+    for (size_t i = 0; ok && i < image.levels.size(); i++) {
+        uint32_t image_size = uint32_t(image.levels[i].data.size());
+        ok = std::fwrite(&image_size, 4, 1, f) == 1
+            && std::fwrite(&image.levels[i].data[0], image_size, 1, f) == 1
+            && std::fwrite(padding, ((image_size + 3) & ~uint32_t(3)) - image_size, 1, f) <= 1;
+    }
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok)
+        fprintf(stderr, "%s: cannot write file\n", filename.c_str());
+    return ok;
+}
+
+static void bc1_colors(const unsigned char* block, bool three_color_alpha, unsigned char colors[4][4])
+{
+    unsigned int c0 = block[0] | (block[1] << 8);
+    unsigned int c1 = block[2] | (block[3] << 8);
+    for (int i = 0; i < 2; i++) {
+        unsigned int c = (i == 0 ? c0 : c1);
+        colors[i][0] = static_cast<unsigned char>(((c >> 11) & 31) * 255 / 31);
+        colors[i][1] = static_cast<unsigned char>(((c >> 5) & 63) * 255 / 63);
+        colors[i][2] = static_cast<unsigned char>((c & 31) * 255 / 31);
+        colors[i][3] = 255;
+    }
+    for (int j = 0; j < 3; j++) {
+        if (c0 > c1) {
+            colors[2][j] = static_cast<unsigned char>((2 * colors[0][j] + colors[1][j] + 1) / 3);
+            colors[3][j] = static_cast<unsigned char>((colors[0][j] + 2 * colors[1][j] + 1) / 3);
+        } else {
+            colors[2][j] = static_cast<unsigned char>((colors[0][j] + colors[1][j] + 1) / 2);
+            colors[3][j] = 0;
+        }
+    }
+    colors[2][3] = 255;
+    colors[3][3] = (c0 > c1 || !three_color_alpha ? 255 : 0);
+}
+
+static void bc_decompress_level(GLenum internal_format, ktx_level& level)
+{
+    size_t block_size = ktx_block_size(internal_format);
+    unsigned int blocks_x = (level.width + 3) / 4;
+    unsigned int blocks_y = (level.height + 3) / 4;
+    std::vector<unsigned char> rgba(4 * size_t(level.width) * level.height);
+
+    for (unsigned int by = 0; by < blocks_y; by++) {
+        for (unsigned int bx = 0; bx < blocks_x; bx++) {
+            const unsigned char* block = &level.data[block_size * (size_t(by) * blocks_x + bx)];
+            const unsigned char* color_block = block;
+            unsigned char alphas[8];
+            uint64_t alpha_bits = 0;
+            bool has_alpha_block = (internal_format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+            if (has_alpha_block) {
+                alphas[0] = block[0];
+                alphas[1] = block[1];
+                for (int i = 1; i < 7; i++) {
+                    if (alphas[0] > alphas[1])
+                        alphas[i + 1] = static_cast<unsigned char>(((7 - i) * alphas[0] + i * alphas[1] + 3) / 7);
+                    else if (i < 5)
+                        alphas[i + 1] = static_cast<unsigned char>(((5 - i) * alphas[0] + i * alphas[1] + 2) / 5);
+                }
+                if (alphas[0] <= alphas[1]) {
+                    alphas[6] = 0;
+                    alphas[7] = 255;
+                }
+                for (int i = 7; i >= 2; i--)
+                    alpha_bits = (alpha_bits << 8) | block[i];
+                color_block = block + 8;
+            }
+
+            unsigned char colors[4][4];
+            bc1_colors(color_block, internal_format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, colors);
+            uint32_t indices = color_block[4] | (color_block[5] << 8) | (color_block[6] << 16) | (uint32_t(color_block[7]) << 24);
+
+            for (unsigned int y = 0; y < 4; y++) {
+                for (unsigned int x = 0; x < 4; x++) {
+                    unsigned int px = 4 * bx + x;
+                    unsigned int py = 4 * by + y;
+                    if (px >= level.width || py >= level.height)
+                        continue;
+                    unsigned int i = 4 * y + x;
+                    unsigned char* dst = &rgba[4 * (size_t(py) * level.width + px)];
+                    std::memcpy(dst, colors[(indices >> (2 * i)) & 3], 4);
+                    if (has_alpha_block)
+                        dst[3] = alphas[(alpha_bits >> (3 * i)) & 7];
+                }
+            }
+        }
+    }
+    level.data.swap(rgba);
+}
+
+bool decompress_ktx(ktx_image& image)
+{
+    switch (image.internal_format) {
+    case GL_RGBA8:
+        return true;
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        for (size_t i = 0; i < image.levels.size(); i++)
+            bc_decompress_level(image.internal_format, image.levels[i]);
+        image.internal_format = GL_RGBA8;
+        return true;
+    default:
+        fprintf(stderr, "ktx: cannot decompress format 0x%04X\n", image.internal_format);
+        return false;
+    }
+}
+
+bool ktx_supported(const ktx_image& image)
+{
+    switch (image.internal_format) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        return GLEW_EXT_texture_compression_s3tc;
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        return GLEW_ARB_texture_compression_bptc || GLEW_VERSION_4_2;
+    default:
+        return true;
+    }
+}
+
+bool load_ktx(GLenum target, const std::string& filename)
+{
+    ktx_image image;
+    if (!read_ktx(filename, image))
+        return false;
+    if (!ktx_supported(image) && !decompress_ktx(image))
+        return false;
+
+    GLint ua_bak;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &ua_bak);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (size_t i = 0; i < image.levels.size(); i++) {
+        const ktx_level& level = image.levels[i];
+        if (image.internal_format == GL_RGBA8)
+            glTexImage2D(target, i, GL_RGBA8, level.width, level.height, 0,
+                    GL_RGBA, GL_UNSIGNED_BYTE, &level.data[0]);
+        else
+            glCompressedTexImage2D(target, i, image.internal_format, level.width, level.height, 0,
+                    level.data.size(), &level.data[0]);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, ua_bak);
+    return true;
+}
+
 #ifdef HAVE_GTA
 
 bool load_gta(GLenum target, const std::string& filename, bool reverse_y)
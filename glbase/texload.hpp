@@ -9,6 +9,7 @@
 #define TEXLOAD_H
 
 #include <string>
+#include <vector>
 
 /* Read and write textures from and to PNG files.
  * Return success (true) or error (false).
@@ -28,6 +29,46 @@
 bool load_png(GLenum target, const std::string& filename, bool reverse_y = true);
 bool save_png(GLenum target, const std::string& filename, bool reverse_y = true);
 
+/* Read and write textures from and to KTX (version 1.1) files.
+ *
+ * Supported are 2D textures with all their mipmap levels, either uncompressed
+ * (GL_RGBA8) or block compressed with BC1 (GL_COMPRESSED_RGB(A)_S3TC_DXT1_EXT),
+ * BC3 (GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) or BC7
+ * (GL_COMPRESSED_RGBA_BPTC_UNORM). Compressed levels are uploaded as they are,
+ * without decoding.
+ *
+ * Block compressed data cannot be flipped cheaply, so KTX files are expected
+ * to store line 0 at the bottom as OpenGL does (KTXorientation "S=r,T=u").
+ *
+ * read_ktx() and write_ktx() do not need a GL context. decompress_ktx()
+ * converts BC1 and BC3 images to GL_RGBA8 on the CPU, for drivers without
+ * EXT_texture_compression_s3tc; BC7 cannot be decompressed.
+ * ktx_supported() needs a current context and tells whether the driver can
+ * sample the format of an image directly.
+ *
+ * load_ktx() reads a file and uploads all levels to the texture bound to
+ * 'target', decompressing if the driver does not support the format.
+ */
+struct ktx_level {
+    unsigned int width;
+    unsigned int height;
+    std::vector<unsigned char> data;
+};
+struct ktx_image {
+    GLenum internal_format;     // GL_RGBA8 or one of the compressed formats above
+    std::vector<ktx_level> levels;
+};
+bool read_ktx(const unsigned char* data, size_t size, ktx_image& image);
+bool read_ktx(const std::string& filename, ktx_image& image);
+bool write_ktx(const std::string& filename, const ktx_image& image);
+bool decompress_ktx(ktx_image& image);
+bool ktx_supported(const ktx_image& image);
+bool load_ktx(GLenum target, const std::string& filename);
+
+/* Returns the size in bytes of one 'width' x 'height' level in GL_RGBA8 or one
+ * of the compressed formats above. */
+size_t texture_level_size(GLenum internal_format, unsigned int width, unsigned int height);
+
 #ifdef HAVE_GTA
 /* Read and write textures from and to GTA files.
  * Return success (true) or error (false).
@@ -0,0 +1,541 @@
+#include "gui/benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <QElapsedTimer>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+#include <QDebug>
+
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "glbase/geometries.hpp"
+#include "glbase/texload.hpp"
+#include "gui/config.h"
+#include "planets/flathierarchy.h"
+#include "planets/meshdata.h"
+#include "planets/planet.h"
+#include "planets/programcache.h"
+#include "planets/scene.h"
+#include "planets/spheremesh.h"
+#include "planets/texturecache.h"
+#include "planets/textureloader.h"
+
+namespace {
+    // Timer results are read this many frames late, so reading them does not stall the pipeline.
+    const unsigned int s_queryLag = 3;
+    const unsigned int s_queryCount = s_queryLag + 1;
+
+    double percentile(std::vector<double> values, double p)
+    {
+        if (values.empty())
+            return 0.0;
+        std::sort(values.begin(), values.end());
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+        return values[std::max<size_t>(rank, 1) - 1];
+    }
+
+    double mean(const std::vector<double>& values)
+    {
+        double sum = 0.0;
+        for (double v : values)
+            sum += v;
+        return values.empty() ? 0.0 : sum / values.size();
+    }
+}
+
+Benchmark::Benchmark(const BenchmarkOptions& options) :
+    _options(options)
+{
+    qDebug() << "Benchmark constructor called.";
+}
+
+bool Benchmark::parseArguments(int argc, char* argv[], BenchmarkOptions& options)
+{
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+    if (std::find(arguments.begin(), arguments.end(), "--benchmark") == arguments.end())
+        return false;
+    options.scene = SceneOptions::parse(arguments);
+
+    // Arguments not meant for the benchmark, e.g. Qt's -platform, are left to Qt and the scene.
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        const char* value = (i + 1 < argc ? argv[i + 1] : nullptr);
+        if (!value)
+        {
+            if (arg == "--compare-mipmaps")
+                options.compareMipmaps = true;
+            else if (arg == "--compare-geometry")
+                options.compareGeometry = true;
+            else if (arg == "--compare-spheres")
+                options.compareSpheres = true;
+            else if (arg == "--compare-hierarchy")
+                options.compareHierarchy = true;
+            else if (arg == "--precision")
+                options.precision = true;
+            continue;
+        }
+        if (arg == "--frames")
+            options.frames = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+        else if (arg == "--warmup")
+            options.warmupFrames = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+        else if (arg == "--size")
+            std::sscanf(value, "%dx%d", &options.width, &options.height);
+        else if (arg == "--timestep")
+            options.timestepMs = std::strtof(value, nullptr);
+        else if (arg == "--distance")
+            options.cameraDistance = std::strtof(value, nullptr);
+        else if (arg == "--dump")
+            options.dumpDirectory = value;
+        else if (arg == "--dump-interval")
+            options.dumpInterval = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+        else if (arg == "--compare-mipmaps")
+        {
+            options.compareMipmaps = true;
+            continue;
+        }
+        else if (arg == "--compare-geometry")
+        {
+            options.compareGeometry = true;
+            continue;
+        }
+        else if (arg == "--compare-spheres")
+        {
+            options.compareSpheres = true;
+            continue;
+        }
+        else if (arg == "--compare-hierarchy")
+        {
+            options.compareHierarchy = true;
+            continue;
+        }
+        else if (arg == "--precision")
+        {
+            options.precision = true;
+            continue;
+        }
+        else
+            continue;
+        i++;
+    }
+    options.frames = std::max(options.frames, 1u);
+    options.width = std::max(options.width, 1);
+    options.height = std::max(options.height, 1);
+    if (!options.dumpDirectory.empty() && options.dumpInterval == 0)
+        options.dumpInterval = 1;
+    return true;
+}
+
+int Benchmark::run()
+{
+    if (_options.precision)
+    {
+        reportPrecision();
+        return 0;
+    }
+
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!surface.isValid() || !context.create() || !context.makeCurrent(&surface))
+    {
+        fprintf(stderr, "Benchmark: cannot create an offscreen OpenGL context.\n");
+        return 1;
+    }
+
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+    if (GLEW_OK != err)
+    {
+        fprintf(stderr, "Error: %s\n", glewGetErrorString(err));
+        return 1;
+    }
+    glGetError();
+
+    printf("Benchmark on %s, OpenGL %s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+            reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    printf("%u frames after %u warm-up frames at %dx%d, %.2f ms per frame, seed %u\n", _options.frames,
+            _options.warmupFrames, _options.width, _options.height, _options.timestepMs, _options.scene.seed);
+
+    Scene::initResources();
+    int result = 0;
+    if (!createFramebuffer())
+    {
+        fprintf(stderr, "Benchmark: framebuffer incomplete.\n");
+        result = 1;
+    }
+    else if (_options.compareMipmaps)
+    {
+        // Fill rate with and without mipmaps; textures are reloaded for the second pass.
+        Timings mipmapped, plain;
+        bool oldMipmaps = Config::mipmaps;
+        Config::mipmaps = true;
+        bool ok = runPass("mipmaps", mipmapped);
+        Config::mipmaps = false;
+        ok = ok && runPass("no-mipmaps", plain);
+        Config::mipmaps = oldMipmaps;
+        if (ok)
+        {
+            report("mipmaps", mipmapped);
+            report("no-mipmaps", plain);
+            printf("GPU time with mipmaps: %.1f%% of the time without (median)\n",
+                    100.0 * percentile(mipmapped.gpu, 50.0) / std::max(percentile(plain.gpu, 50.0), 1e-9));
+        }
+        result = (ok ? 0 : 1);
+    }
+    else if (_options.compareGeometry)
+    {
+        // Spheres, rings and orbits from buffers and from gl_VertexID; the scene is rebuilt for each pass.
+        Timings buffered, procedural;
+        size_t bufferedBytes = 0, proceduralBytes = 0;
+        bool oldProcedural = Config::proceduralMeshes;
+        Config::proceduralMeshes = false;
+        bool ok = runPass("buffered", buffered, &bufferedBytes);
+        Config::proceduralMeshes = true;
+        ok = ok && runPass("procedural", procedural, &proceduralBytes);
+        Config::proceduralMeshes = oldProcedural;
+        if (ok)
+        {
+            report("buffered", buffered);
+            report("procedural", procedural);
+            printf("Mesh buffers: %.1f KiB buffered, %.1f KiB procedural\n",
+                    bufferedBytes / 1024.0, proceduralBytes / 1024.0);
+            printf("GPU time procedural: %.1f%% of the buffered time (median)\n",
+                    100.0 * percentile(procedural.gpu, 50.0) / std::max(percentile(buffered.gpu, 50.0), 1e-9));
+        }
+        result = (ok ? 0 : 1);
+    }
+    else if (_options.compareHierarchy)
+    {
+        // The CPU cost of Scene::update() with the flattened and with the recursive hierarchy.
+        Timings flat, recursive;
+        bool oldFlat = Config::flatHierarchy;
+        Config::flatHierarchy = true;
+        bool ok = runPass("flat", flat);
+        Config::flatHierarchy = false;
+        ok = ok && runPass("recursive", recursive);
+        Config::flatHierarchy = oldFlat;
+        if (ok)
+        {
+            report("flat", flat);
+            report("recursive", recursive);
+            printf("Update time flat: %.1f%% of the recursive time (median)\n",
+                    100.0 * percentile(flat.update, 50.0) / std::max(percentile(recursive.update, 50.0), 1e-9));
+        }
+        result = (ok ? 0 : 1);
+    }
+    else if (_options.compareSpheres)
+    {
+        // The sphere meshes are cached per resolution only; each pass builds a new scene and so new meshes.
+        reportSphereMeshes();
+        const Config::SphereMesh types[] = { Config::UVSphere, Config::IcoSphere, Config::CubeSphere };
+        const char* labels[] = { "uv-sphere", "icosphere", "cube-sphere" };
+        Timings timings[3];
+        Config::SphereMesh oldType = Config::sphereMesh;
+        bool ok = true;
+        for (int i = 0; ok && i < 3; i++)
+        {
+            Config::sphereMesh = types[i];
+            ok = runPass(labels[i], timings[i]);
+        }
+        Config::sphereMesh = oldType;
+        if (ok)
+        {
+            for (int i = 0; i < 3; i++)
+                report(labels[i], timings[i]);
+            for (int i = 1; i < 3; i++)
+                printf("GPU time %s: %.1f%% of the uv-sphere time (median)\n", labels[i],
+                        100.0 * percentile(timings[i].gpu, 50.0) / std::max(percentile(timings[0].gpu, 50.0), 1e-9));
+        }
+        result = (ok ? 0 : 1);
+    }
+    else
+    {
+        Timings timings;
+        bool ok = runPass("scene", timings);
+        if (ok)
+            report("scene", timings);
+        result = (ok ? 0 : 1);
+    }
+
+    deleteFramebuffer();
+    Scene::releaseResources();
+    context.doneCurrent();
+    return result;
+}
+
+bool Benchmark::createFramebuffer()
+{
+    glGenTextures(1, &_colorTexture);
+    glBindTexture(GL_TEXTURE_2D, _colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _options.width, _options.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _depthBuffer);
+    // Reversed depth only gains precision with a floating point depth buffer.
+    GLenum depthFormat = Scene::reversedDepth() ? GL_DEPTH_COMPONENT32F : GL_DEPTH_COMPONENT24;
+    glRenderbufferStorage(GL_RENDERBUFFER, depthFormat, _options.width, _options.height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _colorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+void Benchmark::deleteFramebuffer()
+{
+    glDeleteFramebuffers(1, &_framebuffer);
+    glDeleteRenderbuffers(1, &_depthBuffer);
+    glDeleteTextures(1, &_colorTexture);
+    _framebuffer = _depthBuffer = _colorTexture = 0;
+}
+
+bool Benchmark::runPass(const char* label, Timings& timings, size_t* meshBytes)
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = true;
+    {
+        Scene scene;
+        scene.build(_options.scene);
+        scene.init();
+        TextureLoader::instance().finishAll();
+        printf("%s: %zu bodies, scene ready after %.1f ms\n", label, scene.bodyCount(), timer.nsecsElapsed() / 1.0e6);
+        ProgramCache::instance().logStatistics();
+        TextureCache::instance().logStatistics();
+        printf("%s: %.1f KiB of mesh buffers\n", label, MeshData::bufferBytes() / 1024.0);
+        if (meshBytes)
+            *meshBytes = MeshData::bufferBytes();
+
+        glm::dmat4 view = glm::lookAt(glm::dvec3(0.0, 0.0, _options.cameraDistance),
+                                      glm::dvec3(0.0, 0.0, 0.0), glm::dvec3(0.0, 1.0, 0.0));
+        glm::mat4 projection = Scene::projection(static_cast<float>(_options.width) / _options.height);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+        glViewport(0, 0, _options.width, _options.height);
+
+        GLuint queries[s_queryCount];
+        glGenQueries(s_queryCount, queries);
+
+        const unsigned int total = _options.warmupFrames + _options.frames;
+        timings.update.reserve(_options.frames);
+        timings.submit.reserve(_options.frames);
+        timings.gpu.reserve(_options.frames);
+        timings.frame.reserve(_options.frames);
+
+        auto readQuery = [&](unsigned int frame) {
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(queries[frame % s_queryCount], GL_QUERY_RESULT, &ns);
+            if (frame >= _options.warmupFrames)
+                timings.gpu.push_back(ns / 1.0e6);
+        };
+
+        QElapsedTimer frameClock;
+        for (unsigned int i = 0; ok && i < total; i++)
+        {
+            bool measured = i >= _options.warmupFrames;
+            if (i > _options.warmupFrames)
+                timings.frame.push_back(frameClock.nsecsElapsed() / 1.0e6);
+            frameClock.start();
+
+            timer.restart();
+            scene.update(_options.timestepMs, view);
+            double update = timer.nsecsElapsed() / 1.0e6;
+
+            glBeginQuery(GL_TIME_ELAPSED, queries[i % s_queryCount]);
+            timer.restart();
+            scene.draw(projection);
+            double submit = timer.nsecsElapsed() / 1.0e6;
+            glEndQuery(GL_TIME_ELAPSED);
+
+            if (i >= s_queryLag)
+                readQuery(i - s_queryLag);
+
+            if (measured)
+            {
+                timings.update.push_back(update);
+                timings.submit.push_back(submit);
+                unsigned int m = i - _options.warmupFrames;
+                // Reading the frame back stalls; the timings of dumped frames include that.
+                if (_options.dumpInterval > 0 && m % _options.dumpInterval == 0 && !saveFrame(m, label))
+                {
+                    ok = false;
+                    break;
+                }
+            }
+        }
+        glFinish();
+        if (ok)
+        {
+            timings.frame.push_back(frameClock.nsecsElapsed() / 1.0e6);
+            for (unsigned int i = (total > s_queryLag ? total - s_queryLag : 0); i < total; i++)
+                readQuery(i);
+        }
+
+        glDeleteQueries(s_queryCount, queries);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        printf("%s: %zu of %zu bodies visible in the last frame\n", label, scene.visibleBodyCount(), scene.bodyCount());
+    }
+
+    // The next pass loads its textures again, e.g. with other sampler settings.
+    TextureCache::instance().evictUnused();
+    return ok;
+}
+
+bool Benchmark::saveFrame(unsigned int frame, const char* label) const
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "/%s-%05u.png", label, frame);
+    glBindTexture(GL_TEXTURE_2D, _colorTexture);
+    bool ok = save_png(GL_TEXTURE_2D, _options.dumpDirectory + name);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (!ok)
+        fprintf(stderr, "Benchmark: cannot save %s%s\n", _options.dumpDirectory.c_str(), name);
+    return ok;
+}
+
+void Benchmark::report(const char* label, const Timings& timings)
+{
+    printf("%s: %zu frames, times in ms\n", label, timings.frame.size());
+    printf("    %-8s %8s %8s %8s %8s %8s\n", "", "mean", "p50", "p90", "p99", "max");
+    const std::pair<const char*, const std::vector<double>*> rows[] = {
+        { "update", &timings.update },
+        { "submit", &timings.submit },
+        { "gpu", &timings.gpu },
+        { "frame", &timings.frame }
+    };
+    for (const auto& row : rows)
+    {
+        const std::vector<double>& v = *row.second;
+        printf("    %-8s %8.3f %8.3f %8.3f %8.3f %8.3f\n", row.first, mean(v),
+                percentile(v, 50.0), percentile(v, 90.0), percentile(v, 99.0), percentile(v, 100.0));
+    }
+    double meanFrame = mean(timings.frame);
+    printf("    %.1f frames per second\n", meanFrame > 0.0 ? 1000.0 / meanFrame : 0.0);
+}
+
+void Benchmark::reportPrecision() const
+{
+    // Bodies of radius 1 orbit a root body at growing distances, all in one hierarchy.
+    auto root = std::make_shared<Planet>("Zentrum", 1.0f, 0.0f, 0.0f, 0, "", 0.0f, 0.0f);
+    std::vector<std::shared_ptr<Planet>> bodies;
+    for (double distance = 1.0e3; distance <= 1.0e9; distance *= 10.0)
+    {
+        bodies.push_back(std::make_shared<Planet>("Körper " + std::to_string(bodies.size() + 1), 1.0f,
+                                                  static_cast<float>(distance), 0.0f, 0, "", 0.0f, 0.0f));
+        root->addChild(bodies.back());
+    }
+    FlatHierarchy hierarchy;
+    hierarchy.compile(root);
+
+    const float aspectRatio = static_cast<float>(_options.width) / _options.height;
+    const glm::dmat4 projection(Scene::projection(aspectRatio, false));
+    const glm::dvec3 cameraOffset(0.0, 2.0, _options.cameraDistance);
+    const glm::dvec3 yAxis(0.0, 1.0, 0.0);
+    const unsigned int samples = 256;
+    const bool old3DOrbits = Config::show3DOrbits;
+    Config::show3DOrbits = false;
+
+    auto pixels = [&](const glm::dvec4& eye) {
+        glm::dvec4 clip = projection * eye;
+        return glm::dvec2(clip.x / clip.w * 0.5 * _options.width, clip.y / clip.w * 0.5 * _options.height);
+    };
+
+    printf("Screen error of a surface point at %dx%d, max over %u orbit positions:\n",
+            _options.width, _options.height, samples);
+    printf("%14s %18s %18s\n", "distance", "recursive [px]", "flat [px]");
+    std::vector<double> globalRotations(hierarchy.size(), 0.0);
+    std::vector<double> localRotations(hierarchy.size(), 0.0);
+    for (size_t k = 0; k < bodies.size(); k++)
+    {
+        // Children follow the root in the order they were added.
+        const size_t index = k + 1;
+        const double distance = static_cast<float>(1.0e3 * std::pow(10.0, static_cast<double>(k)));
+        double recursiveError = 0.0, flatError = 0.0;
+        for (unsigned int i = 0; i < samples; i++)
+        {
+            // Float angles, so the recursive path, which stores them as float, sees the same orbit position.
+            const double angle = static_cast<float>(360.0 * i / samples + 1.0e-3 * i);
+            glm::dmat4 world = glm::translate(glm::rotate(glm::dmat4(1.0), glm::radians(angle), yAxis),
+                                              glm::dvec3(distance, 0.0, 0.0));
+            glm::dvec3 body(world[3]);
+            glm::dmat4 view = glm::lookAt(body + cameraOffset, body, yAxis);
+            glm::dvec2 reference = pixels(view * world * glm::dvec4(1.0, 0.0, 0.0, 1.0));
+
+            // The flat hierarchy also stores the angle in the bodies, which the recursive update then reuses.
+            globalRotations[index] = angle;
+            hierarchy.evaluate(0.0f, view, globalRotations, localRotations);
+            glm::vec4 flatEye = bodies[k]->modelViewMatrix() * glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+            flatError = std::max(flatError, glm::length(pixels(glm::dvec4(flatEye)) - reference));
+
+            root->update(0.0f, glm::mat4(view));
+            glm::vec4 recursiveEye = bodies[k]->modelViewMatrix() * glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+            recursiveError = std::max(recursiveError, glm::length(pixels(glm::dvec4(recursiveEye)) - reference));
+        }
+        globalRotations[index] = 0.0;
+        printf("%14.0e %18.3g %18.3g\n", distance, recursiveError, flatError);
+    }
+    Config::show3DOrbits = old3DOrbits;
+
+    // Smallest change of the eye distance that still changes the stored depth. Both mappings
+    // give depth = a + b / z for the eye distance z, from the projections the scene uses.
+    const glm::mat4 standard = Scene::projection(aspectRatio, false);
+    const glm::mat4 reversed = Scene::projection(aspectRatio, true);
+    const double standardB = 0.5 * standard[3][2];
+    const double standardFar = standard[3][2] / (standard[2][2] + 1.0);
+    const double reversedA = -reversed[2][2], reversedB = reversed[3][2];
+    printf("Depth resolution of the window's depth buffers:\n");
+    printf("%14s %26s %26s\n", "eye distance", "24-bit, standard (default)", "float32, reversed (FBO)");
+    for (double z = 1.0; z <= 1.0e8; z *= 10.0)
+    {
+        char standardStep[32] = "beyond far plane";
+        if (z <= standardFar)
+            snprintf(standardStep, sizeof(standardStep), "%.3g", std::ldexp(1.0, -24) / (std::abs(standardB) / (z * z)));
+
+        float depth = static_cast<float>(reversedA + reversedB / z);
+        double ulp = std::nextafter(depth, 1.0f) - depth;
+        double reversedStep = ulp / (std::abs(reversedB) / (z * z));
+        printf("%14.0e %26s %26.3g\n", z, standardStep, reversedStep);
+    }
+}
+
+void Benchmark::reportSphereMeshes()
+{
+    const Config::SphereMesh types[] = { Config::UVSphere, Config::IcoSphere, Config::CubeSphere };
+    const char* labels[] = { "uv-sphere", "icosphere", "cube-sphere" };
+    bool oldOrder = Config::vertexCacheOrder;
+    Config::vertexCacheOrder = false;
+    printf("%-12s %8s %8s %9s %12s %14s\n", "sphere", "segments", "vertices", "triangles", "ACMR (built)", "ACMR (tipsify)");
+    for (int i = 0; i < 3; i++)
+    {
+        for (unsigned int level = 0; level < SphereMesh::s_lodLevels; level++)
+        {
+            unsigned int segments = SphereMesh::lodSegments(level);
+            MeshData mesh;
+            SphereMesh::build(segments, mesh, types[i]);
+            std::vector<unsigned int> ordered = optimize_vertex_cache(mesh.indices, mesh.positions.size());
+            printf("%-12s %8u %8zu %9zu %12.3f %14.3f\n", labels[i], segments, mesh.positions.size(),
+                    mesh.indices.size() / 3, vertex_cache_acmr(mesh.indices), vertex_cache_acmr(ordered));
+        }
+    }
+    Config::vertexCacheOrder = oldOrder;
+}
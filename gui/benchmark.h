@@ -0,0 +1,111 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+#include <GL/glew.h>
+
+#include "planets/scene.h"
+
+/**
+ * @brief The BenchmarkOptions struct configures a headless benchmark run
+ */
+struct BenchmarkOptions
+{
+    unsigned int frames = 600;          /**< Measured frames */
+    unsigned int warmupFrames = 60;     /**< Frames rendered before measuring */
+    int width = 1280;
+    int height = 720;
+    float timestepMs = 1000.0f / 60.0f; /**< Simulated time per frame */
+    float cameraDistance = 5.0f;
+    SceneOptions scene;                 /**< The scene, see SceneOptions::parse() */
+    std::string dumpDirectory;          /**< Where frames are saved as PNG; empty saves none */
+    unsigned int dumpInterval = 0;      /**< Saves every n-th measured frame; 0 saves none */
+    bool compareMipmaps = false;        /**< Runs twice, with and without mipmaps */
+    bool compareGeometry = false;       /**< Runs twice, with buffered and with procedural meshes */
+    bool compareSpheres = false;        /**< Runs once per Config::SphereMesh tessellation */
+    bool compareHierarchy = false;      /**< Runs twice, with the flat and with the recursive update */
+    bool precision = false;             /**< Only reports the jitter and depth resolution at large distances */
+};
+
+/**
+ * @brief The Benchmark class renders the scene without a window and reports frame timings
+ *
+ * It creates a QOffscreenSurface with a GL context (this works with Mesa's
+ * llvmpipe, e.g. with "-platform offscreen" or under xvfb-run) and renders
+ * into its own framebuffer object. Every frame advances the scene by a fixed
+ * simulated timestep, so runs are reproducible. For each measured frame it
+ * records the CPU time of the update, the CPU time of submitting the draw
+ * calls, the GPU time from a timer query and the wall time between frames,
+ * and prints their mean and percentiles at the end.
+ *
+ * With --compare-geometry it runs once with the meshes in vertex and index
+ * buffers and once with Config::proceduralMeshes, and compares their GPU
+ * time and the memory of the mesh buffers.
+ *
+ * With --compare-spheres it first lists, for each tessellation of the
+ * spheres and each level of detail, the vertex and triangle count and the
+ * average cache miss ratio (ACMR, transformed vertices per triangle) of a
+ * 16 entry vertex cache before and after reordering. Then it runs once per
+ * tessellation and compares their GPU time.
+ *
+ * With --compare-hierarchy it runs once with the FlatHierarchy update and
+ * once with the recursive Planet::update() (Config::flatHierarchy), and
+ * compares their update times. Use it with --bodies, --depth and --fanout
+ * for the synthetic scenes.
+ *
+ * With --precision it renders nothing. Instead it places bodies 1e3 to 1e9
+ * units from a root body and compares the screen error of their model-view
+ * matrices from the recursive Planet::update() and from
+ * FlatHierarchy::evaluate(), for a camera following each body. It also lists
+ * the depth resolution of the two depth buffers the window draws with: the
+ * default 24-bit one with the standard mapping and the float one of
+ * reversed depth.
+ */
+class Benchmark
+{
+public:
+    explicit Benchmark(const BenchmarkOptions& options);
+
+    /**
+     * @brief parseArguments Reads the benchmark options from the command line
+     * @return true if --benchmark was given; 'options' is only changed then
+     */
+    static bool parseArguments(int argc, char* argv[], BenchmarkOptions& options);
+
+    /**
+     * @brief run Creates the context, runs the benchmark and prints the report
+     * @return the exit code for main()
+     */
+    int run();
+
+private:
+    struct Timings
+    {
+        std::vector<double> update;
+        std::vector<double> submit;
+        std::vector<double> gpu;
+        std::vector<double> frame;
+    };
+
+    bool createFramebuffer();
+    void deleteFramebuffer();
+    bool runPass(const char* label, Timings& timings, size_t* meshBytes = nullptr);
+    bool saveFrame(unsigned int frame, const char* label) const;
+    static void report(const char* label, const Timings& timings);
+    void reportPrecision() const;
+    static void reportSphereMeshes();
+
+    BenchmarkOptions _options;
+
+    GLuint _framebuffer = 0;
+    GLuint _colorTexture = 0;
+    GLuint _depthBuffer = 0;
+};
+
+#endif // BENCHMARK_H
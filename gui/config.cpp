@@ -9,4 +9,28 @@ bool Config::showOrbits = true;
 bool Config::showCoordinateSystem = false;
 bool Config::show3DOrbits = true;
 bool Config::localOrbits = true;
-float Config::laserCutoff = 2.0f;
\ No newline at end of file
+float Config::laserCutoff = 2.0f;
+bool Config::flatHierarchy = true;
+bool Config::instancedBodies = true;
+unsigned int Config::pathPointBudget = 4096;
+float Config::pathTolerance = 0.005f;
+unsigned int Config::pathMaxDays = 36500;
+unsigned int Config::textureUploadsPerFrame = 4;
+bool Config::mipmaps = true;
+float Config::maxAnisotropy = 8.0f;
+bool Config::compressedTextures = true;
+bool Config::programBinaries = true;
+bool Config::simulationThread = true;
+float Config::simulationStepMs = 10.0f;
+bool Config::reversedDepth = true;
+bool Config::culling = true;
+float Config::cullPixelRadius = 0.5f;
+bool Config::sphereLod = true;
+float Config::lodPixelError = 0.5f;
+bool Config::asyncGeometry = true;
+int Config::resolutionDebounceMs = 100;
+bool Config::proceduralMeshes = false;
+bool Config::impostors = true;
+float Config::impostorPixelRadius = 16.0f;
+Config::SphereMesh Config::sphereMesh = Config::IcoSphere;
+bool Config::vertexCacheOrder = true;
\ No newline at end of file
@@ -2,6 +2,12 @@
 #define CONFIG_H
 
 namespace Config {
+    enum SphereMesh {
+        UVSphere,
+        IcoSphere,
+        CubeSphere
+    };
+
     extern float animationSpeed;
     extern bool localRotation;
     extern bool GlobalRotation;
@@ -12,6 +18,30 @@ namespace Config {
     extern bool show3DOrbits;
     extern bool localOrbits;
     extern float laserCutoff;
+    extern bool flatHierarchy;
+    extern bool instancedBodies;
+    extern unsigned int pathPointBudget;
+    extern float pathTolerance;
+    extern unsigned int pathMaxDays;
+    extern unsigned int textureUploadsPerFrame;
+    extern bool mipmaps;
+    extern float maxAnisotropy;
+    extern bool compressedTextures;
+    extern bool programBinaries;
+    extern bool simulationThread;
+    extern float simulationStepMs;
+    extern bool reversedDepth;
+    extern bool culling;
+    extern float cullPixelRadius;
+    extern bool sphereLod;
+    extern float lodPixelError;
+    extern bool asyncGeometry;
+    extern int resolutionDebounceMs;
+    extern bool proceduralMeshes;
+    extern bool impostors;
+    extern float impostorPixelRadius;
+    extern SphereMesh sphereMesh;
+    extern bool vertexCacheOrder;
 }
 
 #endif // CONFIG_H
\ No newline at end of file
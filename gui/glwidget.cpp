@@ -8,12 +8,14 @@
 #include <iostream>
 #include <GL/glew.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <ctime>
 #include <QDebug>
 
 #include "glwidget.hpp"
 
+#include <QCoreApplication>
 #include <QMouseEvent>
 #include <QWheelEvent>
 
@@ -24,72 +26,45 @@
 
 #include "gui/config.h"
 
-#include "planets/coordinatesystem.h"
-#include "planets/deathstar.h"
-#include "planets/planet.h"
-#include "planets/sun.h"
-#include "planets/skybox.h"
-#include "planets/ring.h"
-
-static float randAngle() {
-    return static_cast<float>(rand() % 360);
-}
+#include "planets/programcache.h"
+#include "planets/scene.h"
+#include "planets/simulation.h"
+#include "planets/texturecache.h"
+#include "planets/textureloader.h"
 
 GLWidget::GLWidget(QWidget *&parent) : QOpenGLWidget(parent),
     _updateTimer(this), _stopWatch()
 {
     qDebug() << "GLWidget constructor called.";
     QObject::connect(&_updateTimer, SIGNAL(timeout()), this, SLOT(animateGL()));
-    _updateTimer.start(18);
+    _resolutionTimer.setSingleShot(true);
+    QObject::connect(&_resolutionTimer, SIGNAL(timeout()), this, SLOT(applyPolygonResolution()));
+    // With COREGL_FPS the swap interval is 0 as well, so frames are rendered as fast as possible.
+    _updateTimer.start(::getenv("COREGL_FPS") ? 0 : 18);
     _stopWatch.start();
 
-    srand(static_cast<unsigned int>(time(NULL)));
-
-    _skybox = std::make_shared<Skybox>("Skybox");
-    _coordSystem = std::make_shared<CoordinateSystem>("Coordinate system");
-
-    _earth          = std::make_shared<Planet> ("Erde",     1.0,    0.0,    24.0,   1, ":/res/images/earth.bmp", 0.0f, 0.0f);
-    _earth->setCloudTexture(":/res/images/clouds.bmp");
-    auto moon       = std::make_shared<Planet>("Mond",      0.215,  2.0,    27.3,   27, ":/res/images/moon.bmp", randAngle(), 5.1f);
-    auto sun        = std::make_shared<Sun>("Sonne",        1.2,    6.0,    50.0,   350, ":/res/images/sun.bmp", randAngle(), 7.25f);
-
-    auto mercury    = std::make_shared<Planet>("Merkur",    0.34,   2.32,   1407.5, 150, ":/res/images/mercury.bmp", randAngle(), 7.0f);
-    auto venus      = std::make_shared<Planet>("Venus",     0.34,   3.0,    2802.0, 100, ":/res/images/venus.bmp", randAngle(), 3.4f);
-    auto mars       = std::make_shared<Planet>("Mars",      0.453,  10.6,   24.7,   700, ":/res/images/mars.bmp", randAngle(), 1.85f);
-    auto jupiter    = std::make_shared<Planet>("Jupiter",   0.453,  13.32,  9.9,    3500, ":/res/images/jupiter.bmp", randAngle(), 1.3f);
-    auto saturn     = std::make_shared<Planet>("Saturn",    0.453,  15.92,  10.6,   10500, ":/res/images/saturn.bmp", randAngle(), 2.5f);
-
-    float saturnRadius = 0.453f;
-    auto saturnRing = std::make_shared<Ring>("Saturnring",
-                                            saturnRadius * 1.2f,
-                                            saturnRadius * 2.2f,
-                                            ":/res/images/ring.bmp",
-                                            26.7f);
-    saturn->setRing(saturnRing);
-
-    auto io         = std::make_shared<Planet>("Io",        0.036,  0.8,    10.6,   30, ":/res/images/moon.bmp", randAngle(), 0.04f);
-    auto europa     = std::make_shared<Planet>("Europa",    0.031,  1.0,    10.6,   60, ":/res/images/moon.bmp", randAngle(), 0.47f);
-    auto ganymede   = std::make_shared<Planet>("Ganymed",   0.052,  1.2,    10.6,   120, ":/res/images/moon.bmp", randAngle(), 0.2f);
-    auto callisto   = std::make_shared<Planet>("Callisto",  0.048,  1.8,    10.6,   350, ":/res/images/moon.bmp", randAngle(), 0.2f);
-
-    auto deathStar  = std::make_shared<DeathStar>("Todesstern", 0.315,  2.0,    27.3,    50, ":/res/images/moon.bmp", randAngle(), 2.0f);
-
-    _earth->addChild(moon);
-    _earth->addChild(sun);
-
-    sun->addChild(mercury);
-    sun->addChild(venus);
-    sun->addChild(mars);
-    sun->addChild(jupiter);
-    sun->addChild(saturn);
-    mars->addChild(deathStar);
-
-    jupiter->addChild(io);
-    jupiter->addChild(europa);
-    jupiter->addChild(ganymede);
-    jupiter->addChild(callisto);
-
-    _earth->setLights(sun, deathStar->cone());
+    // The scene can be chosen on the command line, e.g. --bodies 10000 for a synthetic one.
+    std::vector<std::string> arguments;
+    QStringList qtArguments = QCoreApplication::arguments();
+    for (int i = 1; i < qtArguments.size(); i++)
+        arguments.push_back(qtArguments.at(i).toStdString());
+    SceneOptions options = SceneOptions::parse(arguments);
+    if (!options.seeded)
+        options.seed = static_cast<unsigned int>(time(NULL));
+
+    _scene = std::make_shared<Scene>();
+    _scene->build(options);
+}
+
+GLWidget::~GLWidget()
+{
+    qDebug() << "GLWidget destructor called.";
+    // Release the scene while its GL context is still current.
+    makeCurrent();
+    deleteFramebuffer();
+    _scene.reset();
+    Scene::releaseResources();
+    doneCurrent();
 }
 
 void GLWidget::show()
@@ -118,9 +93,19 @@ void GLWidget::initializeGL()
 
     makeCurrent();
 
-    _earth->init();
-    _coordSystem->init();
-    _skybox->init();
+    _textureTimer.start();
+    Scene::initResources();
+    _scene->init();
+    if (Config::simulationThread)
+        _scene->startSimulation(Config::simulationStepMs);
+    _statisticsTimer.start();
+
+    TextureCache::instance().logStatistics();
+    ProgramCache& programs = ProgramCache::instance();
+    programs.logStatistics();
+    qDebug() << (programs.diskHits() == programs.misses() ? "Warm" : "Cold") << "shader start:"
+             << programs.buildMilliseconds() + programs.diskMilliseconds() << "ms for" << programs.misses() << "programs.";
+    qDebug() << "Scene initialized after" << _textureTimer.elapsed() << "ms," << TextureLoader::instance().pending() << "textures decoding.";
 }
 
 void GLWidget::resizeGL(int width, int height)
@@ -130,37 +115,70 @@ void GLWidget::resizeGL(int width, int height)
 
     _width = width;
     _height = (height > 0) ? height : 1;
+
+    deleteFramebuffer();
+    if (Scene::reversedDepth())
+        createFramebuffer(width, height);
 }
 
-void GLWidget::paintGL()
+void GLWidget::createFramebuffer(int width, int height)
 {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-
-    float aspectRatio = static_cast<float>(_width) / static_cast<float>(_height);
-    glm::mat4 projection_matrix = glm::perspective(glm::radians(50.0f),
-                aspectRatio,
-                0.1f, 100.0f);
-
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+
+    glGenRenderbuffers(1, &_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+    if (!complete)
+    {
+        qDebug() << "GLWidget: float depth framebuffer incomplete, drawing with the default depth buffer.";
+        deleteFramebuffer();
+    }
+}
 
-    if (Config::showWireframe)
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    else
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+void GLWidget::deleteFramebuffer()
+{
+    if (_framebuffer == 0)
+        return;
+    glDeleteFramebuffers(1, &_framebuffer);
+    glDeleteRenderbuffers(1, &_depthBuffer);
+    glDeleteRenderbuffers(1, &_colorBuffer);
+    _framebuffer = _depthBuffer = _colorBuffer = 0;
+}
 
-    glDisable(GL_CULL_FACE);
-    _earth->draw(projection_matrix);
-    glEnable(GL_CULL_FACE);
+void GLWidget::paintGL()
+{
+    TextureLoader& loader = TextureLoader::instance();
+    if (loader.pending() > 0 && loader.processFinished(Config::textureUploadsPerFrame) > 0 && loader.pending() == 0)
+    {
+        qDebug() << "All textures uploaded after" << _textureTimer.elapsed() << "ms.";
+        TextureCache::instance().logStatistics();
+    }
 
-    if (Config::showCoordinateSystem)
+    float aspectRatio = static_cast<float>(_width) / static_cast<float>(_height);
+    if (_framebuffer == 0)
     {
-        glDisable(GL_DEPTH_TEST);
-        _coordSystem->draw(projection_matrix);
-        glEnable(GL_DEPTH_TEST);
+        _scene->draw(Scene::projection(aspectRatio));
+        return;
     }
 
-    _skybox->draw(projection_matrix);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    _scene->draw(Scene::projection(aspectRatio));
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, defaultFramebufferObject());
+    glBlitFramebuffer(0, 0, _width, _height, 0, 0, _width, _height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
 }
 
 void GLWidget::mousePressEvent(QMouseEvent *event)
@@ -215,19 +233,23 @@ void GLWidget::animateGL()
     float timeElapsedMs = _stopWatch.nsecsElapsed() / 1000000.0f;
     _stopWatch.restart();
 
-    float camX = _cameraDistance * cos(_cameraAngleY) * sin(_cameraAngleX);
-    float camY = _cameraDistance * sin(_cameraAngleY);
-    float camZ = _cameraDistance * cos(_cameraAngleY) * cos(_cameraAngleX);
+    double camX = _cameraDistance * cos(_cameraAngleY) * sin(_cameraAngleX);
+    double camY = _cameraDistance * sin(_cameraAngleY);
+    double camZ = _cameraDistance * cos(_cameraAngleY) * cos(_cameraAngleX);
 
-    glm::vec3 cameraPosition = glm::vec3(camX, camY, camZ);
-    glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
-    glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::dvec3 cameraPosition = glm::dvec3(camX, camY, camZ);
+    glm::dvec3 cameraTarget = glm::dvec3(0.0, 0.0, 0.0);
+    glm::dvec3 cameraUp = glm::dvec3(0.0, 1.0, 0.0);
 
-    glm::mat4 modelViewMatrix = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
+    glm::dmat4 modelViewMatrix = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
 
-    _earth->update(timeElapsedMs, modelViewMatrix);
-    _coordSystem->update(timeElapsedMs, modelViewMatrix);
-    _skybox->update(timeElapsedMs, modelViewMatrix);
+    _scene->update(timeElapsedMs, modelViewMatrix);
+
+    if (_scene->simulation() && _statisticsTimer.elapsed() >= 5000)
+    {
+        _scene->simulation()->logStatistics();
+        _statisticsTimer.restart();
+    }
 
     update();
 }
@@ -235,10 +257,21 @@ void GLWidget::animateGL()
 void GLWidget::setPolygonResolution(int segments)
 {
     qDebug() << "setPolygonResolution (GL) called with segments:" << segments;
+    _pendingResolution = segments;
+    _resolutionTimer.start(Config::resolutionDebounceMs);
+}
+
+void GLWidget::applyPolygonResolution()
+{
+    QElapsedTimer timer;
+    timer.start();
     makeCurrent();
 
-    if (_earth)
-    {
-        _earth->setResolution(static_cast<unsigned int>(segments));
-    }
+    // Asynchronously only the jobs are queued here; Scene::update() swaps the meshes in once all are built.
+    if (Config::asyncGeometry)
+        _scene->requestResolution(static_cast<unsigned int>(_pendingResolution));
+    else
+        _scene->setResolution(static_cast<unsigned int>(_pendingResolution));
+
+    qDebug() << "Resolution" << _pendingResolution << "blocked the GUI thread for" << timer.nsecsElapsed() / 1.0e6 << "ms.";
 }
\ No newline at end of file
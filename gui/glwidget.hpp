@@ -10,6 +10,12 @@
 
 #include <memory>
 
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+#include <GL/glew.h>
+
 #include <QElapsedTimer>
 #include <QMessageBox>
 #include <QOpenGLWidget>
@@ -17,9 +23,7 @@
 #include <QTimer>
 #include <QPoint>
 
-class Planet;
-class Skybox;
-class CoordinateSystem;
+class Scene;
 
 class GLWidget : public QOpenGLWidget
 {
@@ -29,10 +33,14 @@ private:
 
     QTimer _updateTimer;
     QElapsedTimer _stopWatch;
+    QElapsedTimer _textureTimer;
+    QElapsedTimer _statisticsTimer;
+
+    // Slider moves are collected until it rests for Config::resolutionDebounceMs.
+    QTimer _resolutionTimer;
+    int _pendingResolution = 0;
 
-    std::shared_ptr<Planet> _earth;
-    std::shared_ptr<Skybox> _skybox;
-    std::shared_ptr<CoordinateSystem> _coordSystem;
+    std::shared_ptr<Scene> _scene;
 
     bool _isMousePressed = false;
     QPoint _lastMousePos;
@@ -43,9 +51,18 @@ private:
     int _width = 1;
     int _height = 1;
 
+    // With reversed depth the scene is drawn here, with a float depth buffer, and
+    // blitted to the widget; the default framebuffer only has fixed point depth.
+    GLuint _framebuffer = 0;
+    GLuint _colorBuffer = 0;
+    GLuint _depthBuffer = 0;
+
+    void createFramebuffer(int width, int height);
+    void deleteFramebuffer();
 
 private slots:
     void animateGL();
+    void applyPolygonResolution();
 
 public:
     static void setGLFormat ()
@@ -61,6 +78,8 @@ public:
 
     GLWidget(QWidget*& parent);
 
+    virtual ~GLWidget();
+
     virtual void show();
 
     virtual void initializeGL() override;
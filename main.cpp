@@ -1,10 +1,21 @@
 #include <QApplication>
+#include <QGuiApplication>
 
+#include "gui/benchmark.h"
 #include "gui/glwidget.hpp"
 #include "gui/mainwindow.hpp"
 
 int main(int argc, char *argv[])
 {
+    // headless benchmark: tychobrahe --benchmark [--frames n] [--size wxh] ...
+    BenchmarkOptions benchmarkOptions;
+    if (Benchmark::parseArguments(argc, argv, benchmarkOptions))
+    {
+        QGuiApplication app(argc, argv);
+        GLWidget::setGLFormat();
+        return Benchmark(benchmarkOptions).run();
+    }
+
     QApplication app(argc, argv);
 
     // set gl format
@@ -0,0 +1,158 @@
+#include "planets/assetbundle.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include <QDebug>
+
+#include <GL/glew.h>
+
+#include "glbase/texload.hpp"
+#include "planets/textureloader.h"
+
+namespace {
+    // Larger than any GL_MAX_TEXTURE_SIZE; keeps the level sizes within int.
+    const uint32_t s_maxTextureSize = 1u << 16;
+}
+
+AssetBundle& AssetBundle::instance()
+{
+    static AssetBundle bundle;
+    return bundle;
+}
+
+AssetBundle::~AssetBundle()
+{
+    close();
+}
+
+bool AssetBundle::open(const std::string& path)
+{
+    qDebug() << "AssetBundle::open() called with" << QString::fromStdString(path);
+    close();
+
+    _file.setFileName(QString::fromStdString(path));
+    if (!_file.exists() || !_file.open(QIODevice::ReadOnly))
+        return false;
+
+    _size = _file.size();
+    _data = _file.map(0, _size);
+    const bundle_header* header = reinterpret_cast<const bundle_header*>(_data);
+    if (!_data || _size < static_cast<qint64>(sizeof(bundle_header))
+            || std::memcmp(header->magic, bundle_magic, 4) != 0 || header->version != bundle_version
+            || _size < static_cast<qint64>(sizeof(bundle_header) + header->entry_count * sizeof(bundle_entry)))
+    {
+        qDebug() << "Not a valid asset bundle:" << QString::fromStdString(path);
+        close();
+        return false;
+    }
+
+    const bundle_entry* entries = reinterpret_cast<const bundle_entry*>(_data + sizeof(bundle_header));
+    for (uint32_t i = 0; i < header->entry_count; ++i)
+    {
+        const bundle_entry& entry = entries[i];
+        // Written as a subtraction, so a huge offset or size cannot wrap around.
+        bool valid = entry.offset % bundle_alignment == 0 && entry.size <= static_cast<uint64_t>(_size)
+                && entry.offset <= static_cast<uint64_t>(_size) - entry.size
+                && entry.name[sizeof(entry.name) - 1] == '\0';
+        if (valid && entry.kind == bundle_texture)
+        {
+            // A full mip chain of the larger side at most; texture() shifts the sizes by the level.
+            uint32_t maxLevels = 1;
+            while ((std::max(entry.width, entry.height) >> maxLevels) > 0)
+                ++maxLevels;
+            valid = entry.width > 0 && entry.height > 0 && entry.width <= s_maxTextureSize
+                    && entry.height <= s_maxTextureSize && entry.level_count >= 1 && entry.level_count <= maxLevels;
+        }
+        if (!valid)
+        {
+            qDebug() << "Skipping invalid asset bundle entry" << i;
+            continue;
+        }
+        _entries[entry.name] = &entry;
+    }
+
+    qDebug() << "AssetBundle:" << _entries.size() << "entries," << _size / 1024 << "KiB mapped.";
+    return true;
+}
+
+void AssetBundle::close()
+{
+    _entries.clear();
+    if (_data)
+        _file.unmap(const_cast<uchar*>(_data));
+    _data = nullptr;
+    _size = 0;
+    if (_file.isOpen())
+        _file.close();
+}
+
+bool AssetBundle::isOpen() const
+{
+    return _data != nullptr;
+}
+
+const bundle_entry* AssetBundle::find(const std::string& resource) const
+{
+    // Entries are named without the extension, so e.g. a KTX can replace a BMP.
+    size_t slash = resource.find_last_of('/');
+    size_t dot = resource.find_last_of('.');
+    std::string name = (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+            ? resource.substr(0, dot) : resource;
+
+    auto it = _entries.find(name);
+    return (it == _entries.end() ? nullptr : it->second);
+}
+
+bool AssetBundle::texture(const std::string& resource, bool flipY, DecodedImage& image) const
+{
+    const bundle_entry* entry = find(resource);
+    if (!entry || entry->kind != bundle_texture || entry->level_count == 0)
+        return false;
+
+    bool flip = (flipY != ((entry->flags & bundle_bottom_up) != 0));
+    if (flip && entry->internal_format != GL_RGBA8)
+        return false;   // block-compressed lines cannot be flipped cheaply
+
+    std::vector<MipLevel> levels(entry->level_count);
+    uint64_t offset = entry->offset;
+    for (uint32_t i = 0; i < entry->level_count; ++i)
+    {
+        MipLevel& level = levels[i];
+        level.width = std::max(entry->width >> i, 1u);
+        level.height = std::max(entry->height >> i, 1u);
+        size_t size = texture_level_size(entry->internal_format, level.width, level.height);
+        if (offset + size > entry->offset + entry->size)
+            return false;
+
+        if (flip)
+        {
+            size_t lineSize = static_cast<size_t>(level.width) * 4;
+            level.pixels.resize(size);
+            for (int y = 0; y < level.height; ++y)
+                std::memcpy(&level.pixels[lineSize * y], _data + offset + lineSize * (level.height - 1 - y), lineSize);
+        }
+        else
+        {
+            level.mapped = _data + offset;
+            level.mappedSize = size;
+        }
+        offset = bundle_align(offset + size);
+    }
+
+    image.internalFormat = entry->internal_format;
+    static_cast<MipLevel&>(image) = std::move(levels[0]);
+    image.mipmaps.assign(std::make_move_iterator(levels.begin() + 1), std::make_move_iterator(levels.end()));
+    return true;
+}
+
+bool AssetBundle::text(const std::string& resource, std::string& text) const
+{
+    const bundle_entry* entry = find(resource);
+    if (!entry || entry->kind != bundle_blob)
+        return false;
+
+    text.assign(reinterpret_cast<const char*>(_data + entry->offset), entry->size);
+    return true;
+}
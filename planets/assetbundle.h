@@ -0,0 +1,75 @@
+#ifndef ASSETBUNDLE_H
+#define ASSETBUNDLE_H
+
+#include <map>
+#include <string>
+
+#include <QFile>
+
+#include "glbase/assetbundle.hpp"
+
+struct DecodedImage;
+
+/**
+ * @brief The AssetBundle class maps a bundle file from tools/bundlepack
+ *
+ * The whole file is mapped once by open(); textures and shader sources are
+ * then served straight from the mapping, by the name of the resource they
+ * replace. Resources missing from the bundle are left to the Qt resources.
+ * The lookups are safe to call from worker threads while the bundle is open.
+ */
+class AssetBundle
+{
+public:
+    /**
+     * @brief instance Returns the process-wide bundle
+     */
+    static AssetBundle& instance();
+
+    ~AssetBundle();
+
+    /**
+     * @brief open Maps a bundle file, replacing the open one
+     * @param path the path of the file on disk
+     * @return false if the file is missing or invalid
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief close Unmaps the bundle; no views into it may be in use
+     */
+    void close();
+
+    bool isOpen() const;
+
+    /**
+     * @brief texture Looks up a texture
+     * @param resource the resource name, e.g. ":/res/images/moon.bmp"
+     * @param flipY whether line 0 is wanted at the bottom
+     * @param image receives views into the mapping, or copies if the lines have to be flipped
+     * @return false if there is no such texture, or it cannot be flipped as requested
+     */
+    bool texture(const std::string& resource, bool flipY, DecodedImage& image) const;
+
+    /**
+     * @brief text Looks up a blob, e.g. a shader source
+     * @param resource the resource name, e.g. ":/shader/phong.vs.glsl"
+     * @param text receives the contents
+     * @return false if there is no such blob
+     */
+    bool text(const std::string& resource, std::string& text) const;
+
+private:
+    AssetBundle() = default;
+    AssetBundle(const AssetBundle&) = delete;
+    AssetBundle& operator=(const AssetBundle&) = delete;
+
+    const bundle_entry* find(const std::string& resource) const;
+
+    QFile _file;
+    const unsigned char* _data = nullptr;
+    qint64 _size = 0;
+    std::map<std::string, const bundle_entry*> _entries;
+};
+
+#endif // ASSETBUNDLE_H
@@ -0,0 +1,232 @@
+#include <GL/glew.h>
+#include "planets/bodybatch.h"
+
+#include <cstddef>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "glbase/gltool.hpp"
+#include "gui/config.h"
+#include "planets/impostorbatch.h"
+#include "planets/spheremesh.h"
+
+#include <QDebug>
+
+BodyBatch::BodyBatch(std::string name):
+    Drawable(name),
+    _impostors(std::make_shared<ImpostorBatch>(name + " impostors"))
+{
+    qDebug() << "BodyBatch constructor called for:" << QString::fromStdString(_name);
+}
+
+BodyBatch::~BodyBatch()
+{
+    if (_instanceBuffer != 0)
+        glDeleteBuffers(1, &_instanceBuffer);
+    deleteBuckets();
+}
+
+void BodyBatch::init()
+{
+    qDebug() << "BodyBatch::init() called for:" << QString::fromStdString(_name);
+    Drawable::init();
+    _impostors->init();
+    _textures.build();
+}
+
+int BodyBatch::addTexture(const std::string& path)
+{
+    return _textures.addLayer(path);
+}
+
+void BodyBatch::add(const std::shared_ptr<SphereMesh>& sphere, const glm::mat4& modelViewMatrix, float radius, int textureLayer)
+{
+    bucket(sphere, 0).instances.push_back(Instance{modelViewMatrix, radius, static_cast<float>(textureLayer)});
+}
+
+void BodyBatch::add(unsigned int segments, const glm::mat4& modelViewMatrix, float radius, int textureLayer)
+{
+    bucket(nullptr, segments).instances.push_back(Instance{modelViewMatrix, radius, static_cast<float>(textureLayer)});
+}
+
+void BodyBatch::addImpostor(const glm::mat4& modelViewMatrix, float radius, int textureLayer)
+{
+    _impostors->add(Instance{modelViewMatrix, radius, static_cast<float>(textureLayer)});
+}
+
+BodyBatch::Bucket& BodyBatch::bucket(const std::shared_ptr<SphereMesh>& sphere, unsigned int segments)
+{
+    for (Bucket& b : _buckets)
+    {
+        if (b.sphere == sphere && b.segments == segments)
+            return b;
+    }
+    _buckets.push_back(Bucket());
+    _buckets.back().sphere = sphere;
+    _buckets.back().segments = segments;
+    return _buckets.back();
+}
+
+void BodyBatch::draw(glm::mat4 projection_matrix) const
+{
+    size_t count = 0;
+    for (const Bucket& bucket : _buckets)
+        count += bucket.instances.size();
+    if (count == 0 && _impostors->empty())
+        return;
+
+    if (_program == 0 || _instanceBuffer == 0)
+    {
+        qDebug() << "BodyBatch" << QString::fromStdString(_name) << "not initialized. Call init() first.";
+        for (Bucket& bucket : _buckets)
+            bucket.instances.clear();
+        _impostors->draw(projection_matrix);
+        return;
+    }
+
+    // All buckets share one upload; each draws from its own range.
+    glBindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(Instance), nullptr, GL_STREAM_DRAW);
+    size_t first = 0;
+    for (const Bucket& bucket : _buckets)
+    {
+        if (bucket.instances.empty())
+            continue;
+        glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(Instance), bucket.instances.size() * sizeof(Instance),
+                        bucket.instances.data());
+        first += bucket.instances.size();
+    }
+
+    glUseProgram(_program);
+
+    glUniform1i(uniform(U_HAS_CLOUDS), 0);
+    setLightUniforms(_sun, _laser);
+    glUniformMatrix4fv(uniform(U_PROJECTION_MATRIX), 1, GL_FALSE, glm::value_ptr(projection_matrix));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, _textures.textureID());
+
+    first = 0;
+    for (Bucket& bucket : _buckets)
+    {
+        if (bucket.instances.empty())
+            continue;
+
+        if (bucket.vertexArrayObject == 0)
+        {
+            glGenVertexArrays(1, &bucket.vertexArrayObject);
+            glBindVertexArray(bucket.vertexArrayObject);
+            if (bucket.sphere)
+                bucket.sphere->setupAttributes();
+            glBindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+            for (GLuint i = 3; i <= 8; ++i)
+            {
+                glEnableVertexAttribArray(i);
+                glVertexAttribDivisor(i, 1);
+            }
+        }
+        else
+        {
+            glBindVertexArray(bucket.vertexArrayObject);
+        }
+        setupInstanceAttributes(first);
+
+        if (bucket.sphere)
+        {
+            glDrawElementsInstanced(GL_TRIANGLES, bucket.sphere->indexCount(), bucket.sphere->indexType(), 0,
+                                    static_cast<GLsizei>(bucket.instances.size()));
+        }
+        else
+        {
+            glUniform1i(uniform(U_SEGMENTS), bucket.segments);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6 * bucket.segments * bucket.segments,
+                                  static_cast<GLsizei>(bucket.instances.size()));
+        }
+
+        first += bucket.instances.size();
+        bucket.instances.clear();
+    }
+
+    _impostors->draw(projection_matrix);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glBindVertexArray(0);
+
+    VERIFY(CG::checkError());
+}
+
+void BodyBatch::update(float elapsedTimeMs, glm::mat4 modelViewMatrix)
+{
+}
+
+void BodyBatch::setLights(std::shared_ptr<Sun> sun, std::shared_ptr<Cone> laser)
+{
+    qDebug() << "BodyBatch::setLights() called for:" << QString::fromStdString(_name);
+    _sun = sun;
+    _laser = laser;
+    _impostors->setLights(sun, laser);
+}
+
+void BodyBatch::createObject()
+{
+    qDebug() << "BodyBatch::createObject() called for:" << QString::fromStdString(_name);
+
+    // The bodies pick their meshes themselves; buckets are made for the meshes they use.
+    deleteBuckets();
+
+    if (_instanceBuffer == 0)
+        glGenBuffers(1, &_instanceBuffer);
+    VERIFY(CG::checkError());
+}
+
+void BodyBatch::setupInstanceAttributes(size_t firstInstance) const
+{
+    glBindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+
+    const GLsizei stride = sizeof(Instance);
+    const size_t base = firstInstance * sizeof(Instance);
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        size_t offset = base + offsetof(Instance, modelViewMatrix) + column * sizeof(glm::vec4);
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset));
+    }
+    glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<const void*>(base + offsetof(Instance, radius)));
+    glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<const void*>(base + offsetof(Instance, textureLayer)));
+}
+
+void BodyBatch::deleteBuckets()
+{
+    for (Bucket& bucket : _buckets)
+    {
+        if (bucket.vertexArrayObject != 0)
+            glDeleteVertexArrays(1, &bucket.vertexArrayObject);
+    }
+    _buckets.clear();
+}
+
+std::string BodyBatch::getVertexShader() const
+{
+    std::string source = Drawable::loadShaderFile(":/shader/phong_instanced.vs.glsl");
+    return Config::proceduralMeshes ? proceduralVertexShader(source) : source;
+}
+
+std::string BodyBatch::getFragmentShader() const
+{
+    return layeredFragmentShader(Drawable::loadShaderFile(":/shader/phong.fs.glsl"));
+}
+
+std::string BodyBatch::layeredFragmentShader(const std::string& phongSource)
+{
+    std::string source = CG::replace(phongSource, "uniform sampler2D uTextureSampler;",
+                         "uniform sampler2DArray uTextureSampler;\nflat in float vLayer;");
+    source = CG::replace(source, "texture(uTextureSampler, vTexCoord)",
+                         "texture(uTextureSampler, vec3(vTexCoord, vLayer))");
+    return source;
+}
+
+std::string BodyBatch::getShaderDefines() const
+{
+    return Config::proceduralMeshes ? "#define PROCEDURAL_SPHERE 1\n" : "";
+}
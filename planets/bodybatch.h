@@ -0,0 +1,121 @@
+#ifndef BODYBATCH_H
+#define BODYBATCH_H
+
+#include "planets/drawable.h"
+#include "planets/texturearray.h"
+
+#include <memory>
+#include <vector>
+
+class Sun;
+class Cone;
+class ImpostorBatch;
+class SphereMesh;
+
+/**
+ * @brief The BodyBatch class draws many lit bodies with instancing
+ *
+ * Planets that do not need special treatment hand themselves to the batch
+ * in their draw() via add(). draw() then uploads one instance buffer with
+ * the model-view matrix, radius and texture layer of every queued body and
+ * renders each sphere mesh the bodies asked for, usually their level of
+ * detail, with one instanced draw call. The body textures live in one
+ * TextureArray, registered with addTexture() before init(). With
+ * Config::proceduralMeshes the bodies pass a segment count instead of a
+ * mesh, and the vertex shader generates the spheres. Bodies queued with
+ * addImpostor() are handed to an ImpostorBatch, drawn with the same
+ * textures.
+ */
+class BodyBatch : public Drawable
+{
+public:
+    BodyBatch(std::string name = "BODY BATCH");
+
+    struct Instance
+    {
+        glm::mat4 modelViewMatrix;
+        float radius;
+        float textureLayer;
+    };
+
+    virtual ~BodyBatch();
+
+    virtual void init() override;
+
+    /**
+     * @brief addTexture Registers a body texture in the texture array
+     * @param path the path of the image
+     * @return the layer to pass to add()
+     */
+    int addTexture(const std::string& path);
+
+    /**
+     * @brief add Queues a body for the next draw()
+     * @param sphere the unit sphere mesh to draw the body with
+     * @param modelViewMatrix the model-view matrix of the body
+     * @param radius the radius the unit sphere is scaled to
+     * @param textureLayer the layer returned by addTexture()
+     */
+    void add(const std::shared_ptr<SphereMesh>& sphere, const glm::mat4& modelViewMatrix, float radius, int textureLayer);
+
+    /**
+     * @brief add Queues a body drawn with a sphere generated in the vertex shader
+     * @param segments the segments of the sphere, see Planet::proceduralSegments()
+     */
+    void add(unsigned int segments, const glm::mat4& modelViewMatrix, float radius, int textureLayer);
+
+    /**
+     * @brief addImpostor Queues a body drawn as a ray-cast sphere, see ImpostorBatch
+     */
+    void addImpostor(const glm::mat4& modelViewMatrix, float radius, int textureLayer);
+
+    /**
+     * @brief draw Draws and clears all queued bodies
+     * @param projection_matrix the current projection matrix
+     */
+    virtual void draw(glm::mat4 projection_matrix) const override;
+
+    virtual void update(float elapsedTimeMs, glm::mat4 modelViewMatrix) override;
+
+    virtual void setLights(std::shared_ptr<Sun> sun, std::shared_ptr<Cone> laser);
+
+    /**
+     * @brief layeredFragmentShader Makes the phong fragment shader sample the body texture from its array layer
+     * @param phongSource the source of shader/phong.fs.glsl
+     */
+    static std::string layeredFragmentShader(const std::string& phongSource);
+
+protected:
+    // The bodies drawn with one sphere mesh, or one generated sphere if 'sphere'
+    // is empty, in a vertex array of their own.
+    struct Bucket
+    {
+        std::shared_ptr<SphereMesh> sphere;
+        unsigned int segments = 0;
+        GLuint vertexArrayObject = 0;
+        std::vector<Instance> instances;
+    };
+
+    virtual void createObject() override;
+    virtual std::string getVertexShader() const override;
+    virtual std::string getFragmentShader() const override;
+    virtual std::string getShaderDefines() const override;
+
+    Bucket& bucket(const std::shared_ptr<SphereMesh>& sphere, unsigned int segments);
+
+    // Points the instance attributes of the bound vertex array at the given first instance.
+    void setupInstanceAttributes(size_t firstInstance) const;
+    void deleteBuckets();
+
+    GLuint _instanceBuffer = 0;
+    TextureArray _textures;
+    std::shared_ptr<ImpostorBatch> _impostors;
+
+    // Filled by the bodies during their const draw().
+    mutable std::vector<Bucket> _buckets;
+
+    std::shared_ptr<Sun> _sun;
+    std::shared_ptr<Cone> _laser;
+};
+
+#endif // BODYBATCH_H
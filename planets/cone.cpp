@@ -13,9 +13,14 @@
 #include "glbase/gltool.hpp"
 
 #include "gui/config.h"
+#include "planets/meshdata.h"
 
 #include <QDebug>
 
+namespace {
+    const float s_height = 10.0f;
+}
+
 Cone::Cone(std::string name, float distance):
     Drawable(name),
     _distance(distance), _angle(.0f)
@@ -34,10 +39,10 @@ void Cone::draw(glm::mat4 projection_matrix) const
     glUseProgram(_program);
     glBindVertexArray(_vertexArrayObject);
 
-    glUniformMatrix4fv(glGetUniformLocation(_program, "projection_matrix"), 1, GL_FALSE, glm::value_ptr(projection_matrix));
-    glUniformMatrix4fv(glGetUniformLocation(_program, "modelview_matrix"), 1, GL_FALSE, glm::value_ptr(_modelViewMatrix));
+    glUniformMatrix4fv(uniform(U_PROJECTION_MATRIX), 1, GL_FALSE, glm::value_ptr(projection_matrix));
+    glUniformMatrix4fv(uniform(U_MODELVIEW_MATRIX), 1, GL_FALSE, glm::value_ptr(_modelViewMatrix));
 
-    glDrawElements(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, _indexCount, _indexType, 0);
 
     glBindVertexArray(0);
     VERIFY(CG::checkError());
@@ -58,6 +63,11 @@ void Cone::update(float elapsedTimeMs, glm::mat4 modelViewMatrix)
     _direction = glm::normalize(glm::vec3(_modelViewMatrix * glm::vec4(0.0f, 1.0f, 0.0f, 0.0f)));
 }
 
+float Cone::reach() const
+{
+    return _distance + s_height / std::cos(glm::radians(Config::laserCutoff));
+}
+
 std::string Cone::getVertexShader() const
 {
     return Drawable::loadShaderFile(":/shader/simple.vs.glsl");
@@ -68,92 +78,58 @@ std::string Cone::getFragmentShader() const
     return Drawable::loadShaderFile(":/shader/cone.fs.glsl");
 }
 
+std::function<void(MeshData&)> Cone::meshBuilder(unsigned int segments) const
+{
+    float cutoff = Config::laserCutoff;
+    return [cutoff, segments](MeshData& mesh) {
+        float height = s_height;
+        float angleRad = glm::radians(cutoff);
+        float baseRadius = tan(angleRad) * height;
+
+        mesh.reserve(2 + 2 * (segments + 1), 6 * segments);
+
+        unsigned int apexIndex = 0;
+        mesh.positions.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
+        mesh.normals.push_back(glm::vec3(0.0f, -1.0f, 0.0f));
+        mesh.texCoords.push_back(glm::vec2(0.5f, 0.5f));
+        unsigned int baseCenterIndex = 1;
+        mesh.positions.push_back(glm::vec3(0.0f, height, 0.0f));
+        mesh.normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+        mesh.texCoords.push_back(glm::vec2(0.5f, 0.5f));
+        for(unsigned int i = 0; i <= segments; ++i)
+        {
+            float angle = (float)i / segments * 2.0f * glm::pi<float>();
+            float x = cos(angle) * baseRadius;
+            float z = sin(angle) * baseRadius;
+            mesh.positions.push_back(glm::vec3(x, height, z));
+            mesh.normals.push_back(glm::normalize(glm::vec3(x, baseRadius, z)));
+            mesh.texCoords.push_back(glm::vec2((float)i / segments, 1.0f));
+            mesh.positions.push_back(glm::vec3(x, height, z));
+            mesh.normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+            mesh.texCoords.push_back(glm::vec2(cos(angle) * 0.5f + 0.5f, sin(angle) * 0.5f + 0.5f));
+        }
+        for(unsigned int i = 0; i < segments; ++i)
+        {
+            unsigned int i0_side = 2 + i * 2;
+            unsigned int i1_side = 2 + (i + 1) * 2;
+            unsigned int i0_base = 2 + i * 2 + 1;
+            unsigned int i1_base = 2 + (i + 1) * 2 + 1;
+            mesh.indices.push_back(apexIndex);
+            mesh.indices.push_back(i1_side);
+            mesh.indices.push_back(i0_side);
+            mesh.indices.push_back(baseCenterIndex);
+            mesh.indices.push_back(i0_base);
+            mesh.indices.push_back(i1_base);
+        }
+    };
+}
+
 void Cone::createObject()
 {
     qDebug() << "Cone::createObject() called for" << QString::fromStdString(_name);
-    float height = 10.0f;
-    float angleRad = glm::radians(Config::laserCutoff);
-    float baseRadius = tan(angleRad) * height;
-
     _angle = Config::laserCutoff;
 
-    unsigned int segments = _resolutionSegments;
-
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> texCoords;
-    std::vector<unsigned int> indices;
-
-    unsigned int apexIndex = 0;
-    positions.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
-    normals.push_back(glm::vec3(0.0f, -1.0f, 0.0f));
-    texCoords.push_back(glm::vec2(0.5f, 0.5f));
-    unsigned int baseCenterIndex = 1;
-    positions.push_back(glm::vec3(0.0f, height, 0.0f));
-    normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
-    texCoords.push_back(glm::vec2(0.5f, 0.5f));
-    unsigned int currentIndex = 2;
-    for(unsigned int i = 0; i <= segments; ++i)
-    {
-        float angle = (float)i / segments * 2.0f * glm::pi<float>();
-        float x = cos(angle) * baseRadius;
-        float z = sin(angle) * baseRadius;
-        positions.push_back(glm::vec3(x, height, z));
-        normals.push_back(glm::normalize(glm::vec3(x, baseRadius, z)));
-        texCoords.push_back(glm::vec2((float)i / segments, 1.0f));
-        unsigned int sideIndex = currentIndex++;
-        positions.push_back(glm::vec3(x, height, z));
-        normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
-        texCoords.push_back(glm::vec2(cos(angle) * 0.5f + 0.5f, sin(angle) * 0.5f + 0.5f));
-        unsigned int baseIndex = currentIndex++;
-    }
-    for(unsigned int i = 0; i < segments; ++i)
-    {
-        unsigned int i0_side = 2 + i * 2;
-        unsigned int i1_side = 2 + (i + 1) * 2;
-        unsigned int i0_base = 2 + i * 2 + 1;
-        unsigned int i1_base = 2 + (i + 1) * 2 + 1;
-        indices.push_back(apexIndex);
-        indices.push_back(i1_side);
-        indices.push_back(i0_side);
-        indices.push_back(baseCenterIndex);
-        indices.push_back(i0_base);
-        indices.push_back(i1_base);
-    }
-    _indexCount = static_cast<unsigned int>(indices.size());
-
-    if(_vertexArrayObject == 0)
-        glGenVertexArrays(1, &_vertexArrayObject);
-    glBindVertexArray(_vertexArrayObject);
-
-    if (_positionBuffer == 0)
-        glGenBuffers(1, &_positionBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, _positionBuffer);
-    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
-
-    if (_normalBuffer == 0)
-        glGenBuffers(1, &_normalBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, _normalBuffer);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(1);
-
-    if (_texCoordBuffer == 0)
-        glGenBuffers(1, &_texCoordBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, _texCoordBuffer);
-    glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), texCoords.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(2);
-
-    if (_indexBuffer == 0)
-        glGenBuffers(1, &_indexBuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-
-    glBindVertexArray(0);
-    VERIFY(CG::checkError());
+    createMesh();
 }
 
 glm::vec3 Cone::getDirection() const
@@ -15,12 +15,17 @@ public:
 
     virtual void update(float elapsedTimeMs, glm::mat4 modelViewMatrix) override;
 
+    virtual std::function<void(MeshData&)> meshBuilder(unsigned int segments) const override;
+
     float getAngle() const;
 
     glm::vec3 getPosition() const;
 
     glm::vec3 getDirection() const;
 
+    // Distance from the carrying body's center to the far end of the cone.
+    float reach() const;
+
 protected:
 
     virtual std::string getVertexShader() const override;
@@ -33,8 +38,6 @@ protected:
     float _angle;
     glm::vec3 _position;
     glm::vec3 _direction;
-
-    unsigned int _indexCount = 0;
 };
 
 #endif // CONE_H
\ No newline at end of file
@@ -49,11 +49,8 @@ void CoordinateSystem::draw(glm::mat4 projection_matrix) const
     glUseProgram(_program);
     glLineWidth(3.0f);
 
-    GLint projLoc = glGetUniformLocation(_program, "projection_matrix");
-    GLint mvLoc = glGetUniformLocation(_program, "modelview_matrix");
-
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection_matrix));
-    glUniformMatrix4fv(mvLoc, 1, GL_FALSE, glm::value_ptr(_modelViewMatrix));
+    glUniformMatrix4fv(uniform(U_PROJECTION_MATRIX), 1, GL_FALSE, glm::value_ptr(projection_matrix));
+    glUniformMatrix4fv(uniform(U_MODELVIEW_MATRIX), 1, GL_FALSE, glm::value_ptr(_modelViewMatrix));
 
     glBindVertexArray(_vertexArrayObject);
     glDrawArrays(GL_LINES, 0, _verticesCount);
@@ -68,22 +65,6 @@ void CoordinateSystem::update(float elapsedTimeMs, glm::mat4 modelViewMatrix)
     _modelViewMatrix = modelViewMatrix;
 }
 
-void CoordinateSystem::initShader()
-{
-    qDebug() << "CoordinateSystem::initShader() called.";
-    GLuint vs = CG::createCompileShader(GL_VERTEX_SHADER, getVertexShader()); VERIFY(vs);
-    GLuint fs = CG::createCompileShader(GL_FRAGMENT_SHADER, getFragmentShader()); VERIFY(fs);
-
-    _program = glCreateProgram();
-    glAttachShader(_program, vs);
-    glAttachShader(_program, fs);
-
-    glBindAttribLocation(_program, 0, "aPos");
-
-    _program = CG::linkProgram(_program);
-    VERIFY(_program);
-}
-
 std::string CoordinateSystem::getVertexShader() const
 {
     return simpleVertexShader;
@@ -15,7 +15,6 @@ public:
     virtual void update(float elapsedTimeMs, glm::mat4 modelViewMatrix) override;
 
 protected:
-    virtual void initShader() override;
     virtual std::string getVertexShader() const override;
     virtual std::string getFragmentShader() const override;
     virtual void createObject() override;
@@ -1,6 +1,7 @@
 #include "deathstar.h"
 #include "planets/cone.h"
 #include <glm/gtx/transform.hpp>
+#include <algorithm>
 #include <stack>
 #include "gui/config.h"
 #include "glbase/gltool.hpp"
@@ -43,6 +44,13 @@ void DeathStar::setResolution(unsigned int segments)
         _cone->setResolution(segments);
 }
 
+void DeathStar::requestResolution(unsigned int segments, MeshRebuilder& rebuilder)
+{
+    Planet::requestResolution(segments, rebuilder);
+    if (_cone)
+        requestMesh(rebuilder, _cone, segments);
+}
+
 void DeathStar::update(float elapsedTimeMs, glm::mat4 modelViewMatrix)
 {
     glm::mat4 baseOperatingMatrix;
@@ -84,6 +92,15 @@ void DeathStar::update(float elapsedTimeMs, glm::mat4 modelViewMatrix)
     }
 }
 
+void DeathStar::updateAttachments(float elapsedTimeMs, const glm::mat4& parentMatrix,
+                                  const glm::mat4& orbitMatrix, const glm::mat4& anchorMatrix)
+{
+    Planet::updateAttachments(elapsedTimeMs, parentMatrix, orbitMatrix, anchorMatrix);
+
+    if (_cone)
+        _cone->update(elapsedTimeMs, _modelViewMatrix);
+}
+
 void DeathStar::draw(glm::mat4 projection_matrix) const
 {
     Planet::draw(projection_matrix);
@@ -104,4 +121,9 @@ void DeathStar::draw(glm::mat4 projection_matrix) const
 std::shared_ptr<Cone> DeathStar::cone() const
 {
     return _cone;
+}
+
+float DeathStar::boundingRadius() const
+{
+    return _cone ? std::max(Planet::boundingRadius(), _cone->reach()) : Planet::boundingRadius();
 }
\ No newline at end of file
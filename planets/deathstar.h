@@ -25,9 +25,16 @@ public:
     virtual void draw(glm::mat4 projection_matrix) const override;
     std::shared_ptr<Cone> cone() const;
 
+    virtual float boundingRadius() const override;
+
     virtual void setResolution(unsigned int segments) override;
 
+    virtual void requestResolution(unsigned int segments, MeshRebuilder& rebuilder) override;
+
 protected:
+    virtual void updateAttachments(float elapsedTimeMs, const glm::mat4& parentMatrix,
+                                   const glm::mat4& orbitMatrix, const glm::mat4& anchorMatrix) override;
+
     std::shared_ptr<Cone> _cone;
 };
 
@@ -2,14 +2,48 @@
 
 #include <QFile>
 #include <QTextStream>
-#include <QImage>
-#include <QGLWidget>
 #include <QDebug>
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/type_ptr.hpp>
+
 #include "glbase/gltool.hpp"
+#include "gui/config.h"
+#include "planets/assetbundle.h"
+#include "planets/cone.h"
+#include "planets/meshdata.h"
+#include "planets/programcache.h"
+#include "planets/sun.h"
+#include "planets/texturecache.h"
+
+namespace {
+    const char* s_uniformNames[Drawable::U_COUNT] = {
+        "projection_matrix",
+        "modelview_matrix",
+        "projection",
+        "view",
+        "skybox",
+        "uTextureSampler",
+        "uCloudSampler",
+        "uHasClouds",
+        "uTime",
+        "uLightPosView",
+        "uLightColor",
+        "uHasLaser",
+        "uLaserPosView",
+        "uLaserDirView",
+        "uLaserCutoffCos",
+        "uLaserColor",
+        "uColor",
+        "uSegments",
+        "uInnerRadius",
+        "uOuterRadius"
+    };
+}
 
 Drawable::Drawable(std::string name):
     _name(name),
@@ -17,14 +51,30 @@ Drawable::Drawable(std::string name):
     _modelViewMatrix(glm::mat4(1.0f)),
     _resolutionSegments(60),
     _vertexArrayObject(0),
-    _positionBuffer(0),
-    _normalBuffer(0),
-    _texCoordBuffer(0),
-    _indexBuffer(0)
+    _vertexBuffer(0),
+    _indexBuffer(0),
+    _indexCount(0),
+    _indexType(GL_UNSIGNED_INT),
+    _vertexCapacity(0),
+    _indexCapacity(0)
 {
+    std::fill(_uniformLocations, _uniformLocations + U_COUNT, -1);
     qDebug() << "Drawable constructor called for:" << QString::fromStdString(_name);
 }
 
+Drawable::~Drawable()
+{
+    ProgramCache::instance().release(_program);
+    deleteBuffers();
+    if (_vertexArrayObject != 0)
+        glDeleteVertexArrays(1, &_vertexArrayObject);
+}
+
+const glm::mat4& Drawable::modelViewMatrix() const
+{
+    return _modelViewMatrix;
+}
+
 void Drawable::init()
 {
     qDebug() << "Drawable::init() called for:" << QString::fromStdString(_name);
@@ -49,61 +99,174 @@ void Drawable::setResolution(unsigned int segments)
     recreate();
 }
 
+std::function<void(MeshData&)> Drawable::meshBuilder(unsigned int segments) const
+{
+    return nullptr;
+}
+
+void Drawable::applyMesh(unsigned int segments, const MeshData& mesh)
+{
+    _resolutionSegments = std::max(segments, 3u);
+    if (mesh.empty())
+        recreate();
+    else
+        uploadMesh(mesh);
+}
+
+void Drawable::uploadMesh(const MeshData& mesh)
+{
+    const size_t vertexBytes = mesh.vertices.size() * sizeof(PackedVertex);
+    const size_t indexBytes = mesh.indexBytes();
+    const bool growVertices = vertexBytes > _vertexCapacity;
+    const bool growIndices = indexBytes > _indexCapacity;
+
+    if (_vertexArrayObject == 0)
+        glGenVertexArrays(1, &_vertexArrayObject);
+    glBindVertexArray(_vertexArrayObject);
+
+    auto upload = [&](GLenum target, GLuint& buffer, size_t bytes, const void* data, bool grow) {
+        if (buffer == 0)
+            glGenBuffers(1, &buffer);
+        glBindBuffer(target, buffer);
+        if (grow)
+            glBufferData(target, bytes, data, GL_STATIC_DRAW);
+        else
+            glBufferSubData(target, 0, bytes, data);
+    };
+
+    upload(GL_ARRAY_BUFFER, _vertexBuffer, vertexBytes, mesh.vertices.data(), growVertices);
+    MeshData::setupAttributes();
+    upload(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer, indexBytes, mesh.indexData(), growIndices);
+
+    glBindVertexArray(0);
+
+    if (growVertices)
+    {
+        MeshData::countBufferBytes(static_cast<long long>(vertexBytes) - static_cast<long long>(_vertexCapacity));
+        _vertexCapacity = vertexBytes;
+    }
+    if (growIndices)
+    {
+        MeshData::countBufferBytes(static_cast<long long>(indexBytes) - static_cast<long long>(_indexCapacity));
+        _indexCapacity = indexBytes;
+    }
+    _indexCount = static_cast<unsigned int>(mesh.indexCount());
+    _indexType = mesh.indexType();
+    VERIFY(CG::checkError());
+}
+
+void Drawable::createMesh()
+{
+    MeshData mesh;
+    meshBuilder(_resolutionSegments)(mesh);
+    mesh.pack();
+    uploadMesh(mesh);
+}
+
+void Drawable::createProceduralMesh()
+{
+    deleteBuffers();
+    if (_vertexArrayObject == 0)
+        glGenVertexArrays(1, &_vertexArrayObject);
+    _indexCount = 0;
+    VERIFY(CG::checkError());
+}
+
+void Drawable::deleteBuffers()
+{
+    GLuint* buffers[] = { &_vertexBuffer, &_indexBuffer };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer != 0)
+            glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    MeshData::countBufferBytes(-static_cast<long long>(_vertexCapacity + _indexCapacity));
+    _vertexCapacity = 0;
+    _indexCapacity = 0;
+}
+
+std::string Drawable::proceduralVertexShader(const std::string& source) const
+{
+    std::string result = CG::replace(source, "layout (location = 0) in vec3 aPos;",
+                                     loadShaderFile(":/shader/procedural.vs.glsl"));
+    result = CG::replace(result, "layout (location = 1) in vec3 aNormal;\n", "");
+    result = CG::replace(result, "layout (location = 2) in vec2 aTexCoord;\n", "");
+    return CG::replace(result, "void main()\n{", "void main()\n{\n    proceduralVertex();");
+}
+
 void Drawable::initShader()
 {
     qDebug() << "Drawable::initShader() called for:" << QString::fromStdString(_name);
-    _program = glCreateProgram();
-
-    std::string vs_string = getVertexShader();
-    std::string fs_string = getFragmentShader();
-    const char* vs_data = vs_string.c_str();
-    const char* fs_data = fs_string.c_str();
-
-    GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vs, 1, &vs_data, NULL);
-    glCompileShader(vs);
-
-    GLint vs_status;
-    glGetShaderiv(vs, GL_COMPILE_STATUS, &vs_status);
-    if (vs_status == GL_FALSE) {
-        GLint logLen;
-        glGetShaderiv(vs, GL_INFO_LOG_LENGTH, &logLen);
-        std::vector<char> log(logLen);
-        glGetShaderInfoLog(vs, logLen, NULL, log.data());
-        qDebug() << "Vertex Shader Compile Error (" << QString::fromStdString(_name) << "): " << log.data();
+
+    // Drawables with the same sources share one program; a failed build leaves _program at 0.
+    ProgramCache& cache = ProgramCache::instance();
+    cache.release(_program);
+    _program = cache.acquire(getVertexShader(), getFragmentShader(), getShaderDefines(), _name);
+
+    resolveUniforms();
+}
+
+void Drawable::resolveUniforms()
+{
+    // Uniforms the program does not use resolve to -1, which glUniform*() ignores.
+    for (int i = 0; i < U_COUNT; ++i)
+        _uniformLocations[i] = _program ? glGetUniformLocation(_program, s_uniformNames[i]) : -1;
+
+    // Sampler bindings never change, so they are set once here instead of per draw.
+    if (_program)
+    {
+        glUseProgram(_program);
+        glUniform1i(uniform(U_TEXTURE_SAMPLER), 0);
+        glUniform1i(uniform(U_CLOUD_SAMPLER), 1);
+        glUniform1i(uniform(U_SKYBOX), 0);
+        glUseProgram(0);
     }
-    glAttachShader(_program, vs);
-
-    GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fs, 1, &fs_data, NULL);
-    glCompileShader(fs);
-
-    GLint fs_status;
-    glGetShaderiv(fs, GL_COMPILE_STATUS, &fs_status);
-    if (fs_status == GL_FALSE) {
-        GLint logLen;
-        glGetShaderiv(fs, GL_INFO_LOG_LENGTH, &logLen);
-        std::vector<char> log(logLen);
-        glGetShaderInfoLog(fs, logLen, NULL, log.data());
-        qDebug() << "Fragment Shader Compile Error (" << QString::fromStdString(_name) << "): " << log.data();
+}
+
+void Drawable::setLightUniforms(const std::shared_ptr<Sun>& sun, const std::shared_ptr<Cone>& laser) const
+{
+    glm::vec3 lightPosView = glm::vec3(0.0f, 0.0f, 0.0f);
+    glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+
+    if (Config::sunLight && sun)
+    {
+        lightPosView = sun->getPosition();
+        lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
     }
-    glAttachShader(_program, fs);
-
-    glLinkProgram(_program);
-
-    GLint link_status;
-    glGetProgramiv(_program, GL_LINK_STATUS, &link_status);
-    if (link_status == GL_FALSE) {
-        GLint logLen;
-        glGetProgramiv(_program, GL_INFO_LOG_LENGTH, &logLen);
-        std::vector<char> log(logLen);
-        glGetProgramInfoLog(_program, logLen, NULL, log.data());
-        qDebug() << "Shader Program Link Error (" << QString::fromStdString(_name) << "): " << log.data();
+
+    glUniform3fv(uniform(U_LIGHT_POS_VIEW), 1, glm::value_ptr(lightPosView));
+    glUniform3fv(uniform(U_LIGHT_COLOR), 1, glm::value_ptr(lightColor));
+
+    bool hasLaser = (laser != nullptr);
+    glUniform1i(uniform(U_HAS_LASER), hasLaser);
+    if (hasLaser)
+    {
+        glm::vec3 laserPosView = laser->getPosition();
+        glm::vec3 laserDirView = laser->getDirection();
+
+        float cutoffAngleRad = glm::radians(Config::laserCutoff);
+        float cutoffCos = cos(cutoffAngleRad);
+
+        glUniform3fv(uniform(U_LASER_POS_VIEW), 1, glm::value_ptr(laserPosView));
+        glUniform3fv(uniform(U_LASER_DIR_VIEW), 1, glm::value_ptr(laserDirView));
+        glUniform1f(uniform(U_LASER_CUTOFF_COS), cutoffCos);
+
+        glUniform3f(uniform(U_LASER_COLOR), 1.0f, 0.0f, 0.0f);
     }
 }
 
+std::string Drawable::getShaderDefines() const
+{
+    return "";
+}
+
 std::string Drawable::loadShaderFile(std::string path) const
 {
+    std::string source;
+    if (AssetBundle::instance().text(path, source))
+        return source;
+
     QFile f(QString::fromStdString(path));
     if (!f.open(QFile::ReadOnly | QFile::Text))
     {
@@ -116,27 +279,11 @@ std::string Drawable::loadShaderFile(std::string path) const
 
 GLuint Drawable::loadTexture(std::string path)
 {
-    QImage tex;
-    tex.load(QString::fromStdString(path));
-    tex = QGLWidget::convertToGLFormat(tex);
-
-    if(tex.isNull()){
-        qDebug() << "Could not load texture file:" << QString::fromStdString(path);
-        return 0;
-    }
-
-    GLuint texID;
-    glGenTextures(1, &texID);
-    glBindTexture(GL_TEXTURE_2D, texID);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex.width(), tex.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, tex.bits());
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
+    return TextureCache::instance().acquire(path);
+}
 
-    return texID;
+void Drawable::releaseTexture(GLuint& textureID)
+{
+    TextureCache::instance().release(textureID);
+    textureID = 0;
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef DRAWABLE_H
 #define DRAWABLE_H
 
+#include <functional>
+#include <memory>
 #include <string>
 
 #define GLM_FORCE_RADIANS
@@ -14,13 +16,43 @@
 
 class Cone;
 class Sun;
+struct MeshData;
 
 class Drawable{
 
 public:
 
+    // Uniforms used by the shaders, resolved once per program in initShader().
+    enum Uniform {
+        U_PROJECTION_MATRIX,
+        U_MODELVIEW_MATRIX,
+        U_PROJECTION,
+        U_VIEW,
+        U_SKYBOX,
+        U_TEXTURE_SAMPLER,
+        U_CLOUD_SAMPLER,
+        U_HAS_CLOUDS,
+        U_TIME,
+        U_LIGHT_POS_VIEW,
+        U_LIGHT_COLOR,
+        U_HAS_LASER,
+        U_LASER_POS_VIEW,
+        U_LASER_DIR_VIEW,
+        U_LASER_CUTOFF_COS,
+        U_LASER_COLOR,
+        U_COLOR,
+        U_SEGMENTS,
+        U_INNER_RADIUS,
+        U_OUTER_RADIUS,
+        U_COUNT
+    };
+
     Drawable(std::string name = "UNNAMED");
 
+    // Drops the reference to the shared program, which lives in the ProgramCache,
+    // and deletes the vertex array and buffers; the context must be current.
+    virtual ~Drawable();
+
     virtual void init();
 
     virtual void recreate();
@@ -31,32 +63,80 @@ public:
 
     virtual void setResolution(unsigned int segments);
 
+    // Returns a function that builds the geometry for a resolution from captured
+    // values only, so it can run on another thread; empty if the drawable
+    // cannot build its geometry that way.
+    virtual std::function<void(MeshData&)> meshBuilder(unsigned int segments) const;
+
+    // Takes over geometry built by meshBuilder() and packed; recreates the object if the mesh is empty.
+    virtual void applyMesh(unsigned int segments, const MeshData& mesh);
+
+    // The model-view matrix of the last update, without the scaling to the drawable's size.
+    const glm::mat4& modelViewMatrix() const;
+
 protected:
 
     std::string _name;
 
     GLuint _program;
+    GLint _uniformLocations[U_COUNT];
     glm::mat4 _modelViewMatrix;
 
     unsigned int _resolutionSegments;
 
     GLuint _vertexArrayObject;
-    GLuint _positionBuffer;
-    GLuint _normalBuffer;
-    GLuint _texCoordBuffer;
+    GLuint _vertexBuffer;
     GLuint _indexBuffer;
+    unsigned int _indexCount;
+    GLenum _indexType;
+
+    // Allocated bytes of the buffers, so uploads of the same size or smaller reuse them.
+    size_t _vertexCapacity;
+    size_t _indexCapacity;
 
     virtual void initShader();
 
+    void resolveUniforms();
+
+    GLint uniform(Uniform u) const { return _uniformLocations[u]; }
+
+    // Sets the sun and laser uniforms of the phong shaders for the bound program.
+    void setLightUniforms(const std::shared_ptr<Sun>& sun, const std::shared_ptr<Cone>& laser) const;
+
     virtual std::string loadShaderFile(std::string path) const;
 
     virtual GLuint loadTexture(std::string path);
 
+    // Drops a texture from loadTexture() and resets the handle to 0.
+    virtual void releaseTexture(GLuint& textureID);
+
     virtual std::string getVertexShader() const = 0;
 
     virtual std::string getFragmentShader() const = 0;
 
+    // Preprocessor lines inserted after the #version line of both shaders, part of the program cache key.
+    virtual std::string getShaderDefines() const;
+
     virtual void createObject() = 0;
+
+    // Uploads a packed mesh into the vertex array, _vertexBuffer (interleaved
+    // vertices) and _indexBuffer, and sets _indexCount and _indexType.
+    void uploadMesh(const MeshData& mesh);
+
+    // Builds, packs and uploads the mesh of meshBuilder() for the current resolution.
+    void createMesh();
+
+    // Deletes the buffers of uploadMesh() and leaves an empty vertex array, for
+    // shaders that generate their vertices with proceduralVertexShader().
+    void createProceduralMesh();
+
+    void deleteBuffers();
+
+    // Replaces the attributes 0 to 2 of a vertex shader with values that
+    // shader/procedural.vs.glsl computes from gl_VertexID: a unit sphere of
+    // uSegments segments if PROCEDURAL_SPHERE is defined, otherwise an annulus
+    // of uSegments steps between uInnerRadius and uOuterRadius.
+    std::string proceduralVertexShader(const std::string& source) const;
 };
 
 #endif // DRAWABLE_H
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "planets/flathierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtx/transform.hpp>
+
+#include "gui/config.h"
+#include "planets/planet.h"
+#include "planets/spheremesh.h"
+#include "planets/sun.h"
+
+#include <QDebug>
+
+namespace {
+    double wrapDegrees(double angle)
+    {
+        angle = std::fmod(angle, 360.0);
+        if (angle < 0.0)
+            angle += 360.0;
+        return angle;
+    }
+}
+
+FlatHierarchy::StepSettings FlatHierarchy::StepSettings::fromConfig()
+{
+    StepSettings settings;
+    settings.animationSpeed = Config::animationSpeed;
+    settings.localOrbits = Config::localOrbits;
+    settings.globalRotation = Config::GlobalRotation;
+    settings.localRotation = Config::localRotation;
+    return settings;
+}
+
+void FlatHierarchy::compile(std::shared_ptr<Planet> root)
+{
+    _bodies.clear();
+    _parents.clear();
+    _belowSun.clear();
+    _globalRotations.clear();
+    _globalRotationSpeeds.clear();
+    _localRotations.clear();
+    _localRotationSpeeds.clear();
+    _distances.clear();
+    _inclinations.clear();
+
+    _boundingRadii.clear();
+    _pathRadii.clear();
+
+    if (root)
+        append(root.get(), -1, false);
+
+    // Children follow their parents, so a reverse pass sees every subtree complete.
+    _subtreeRadii = _boundingRadii;
+    for (size_t i = _bodies.size(); i-- > 1; )
+    {
+        float reach = static_cast<float>(_distances[i]) + _subtreeRadii[i];
+        _subtreeRadii[_parents[i]] = std::max(_subtreeRadii[_parents[i]], reach);
+    }
+
+    _worldMatrices.assign(_bodies.size(), glm::dmat4(1.0));
+    _orbitMatrices.assign(_bodies.size(), glm::mat4(1.0f));
+    _anchorMatrices.assign(_bodies.size(), glm::mat4(1.0f));
+    _modelViewMatrices.assign(_bodies.size(), glm::mat4(1.0f));
+
+    qDebug() << "FlatHierarchy::compile() flattened" << _bodies.size() << "bodies.";
+}
+
+void FlatHierarchy::append(Planet* body, int parent, bool belowSun)
+{
+    int index = static_cast<int>(_bodies.size());
+
+    _bodies.push_back(body);
+    _parents.push_back(parent);
+    _belowSun.push_back(belowSun);
+    _globalRotations.push_back(body->_globalRotation);
+    _globalRotationSpeeds.push_back(body->_globalRotationSpeed);
+    _localRotations.push_back(body->_localRotation);
+    _localRotationSpeeds.push_back(body->_localRotationSpeed);
+    _distances.push_back(body->_distance);
+    _inclinations.push_back(body->_inclination);
+    _boundingRadii.push_back(body->boundingRadius());
+    // Paths are sampled from the children of the root on, see Planet::calculatePath().
+    _pathRadii.push_back(parent < 0 ? 0.0f : _pathRadii[parent] + body->_distance);
+
+    // Sun::update() switches the orbits of its whole subtree to Config::localOrbits.
+    bool childrenBelowSun = belowSun || dynamic_cast<Sun*>(body) != nullptr;
+    for (const auto& child : body->_children)
+        append(child.get(), index, childrenBelowSun);
+}
+
+void FlatHierarchy::pullRotations()
+{
+    for (size_t i = 0; i < _bodies.size(); ++i)
+    {
+        _globalRotations[i] = _bodies[i]->_globalRotation;
+        _localRotations[i] = _bodies[i]->_localRotation;
+    }
+}
+
+void FlatHierarchy::update(float elapsedTimeMs, const glm::mat4& modelViewMatrix)
+{
+    update(elapsedTimeMs, glm::dmat4(modelViewMatrix));
+}
+
+void FlatHierarchy::update(float elapsedTimeMs, const glm::dmat4& viewMatrix)
+{
+    step(elapsedTimeMs, StepSettings::fromConfig());
+    evaluate(elapsedTimeMs, viewMatrix, _globalRotations, _localRotations);
+}
+
+void FlatHierarchy::step(float elapsedTimeMs, const StepSettings& settings)
+{
+    const size_t count = _bodies.size();
+    const double elapsedSimulatedDays = (elapsedTimeMs / 60000.0) * settings.animationSpeed;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        bool orbiting = _belowSun[i] ? settings.localOrbits : settings.globalRotation;
+        if (orbiting)
+            _globalRotations[i] = wrapDegrees(_globalRotations[i] + elapsedSimulatedDays * _globalRotationSpeeds[i]);
+        if (settings.localRotation)
+            _localRotations[i] = wrapDegrees(_localRotations[i] + elapsedSimulatedDays * _localRotationSpeeds[i]);
+    }
+}
+
+void FlatHierarchy::evaluate(float elapsedTimeMs, const glm::dmat4& viewMatrix,
+                             const std::vector<double>& globalRotations, const std::vector<double>& localRotations)
+{
+    const size_t count = _bodies.size();
+    const glm::dvec3 yAxis(0.0, 1.0, 0.0);
+    const glm::dvec3 zAxis(0.0, 0.0, 1.0);
+
+    // The chain runs in double precision relative to the root; only the final
+    // products with the view matrix, i.e. relative to the camera, become float.
+    for (size_t i = 0; i < count; ++i)
+    {
+        const glm::dmat4 parentMatrix = _parents[i] < 0 ? glm::dmat4(1.0) : _worldMatrices[_parents[i]];
+
+        glm::dmat4 orbitMatrix = Config::show3DOrbits
+                ? glm::rotate(parentMatrix, glm::radians(_inclinations[i]), zAxis)
+                : parentMatrix;
+        glm::dmat4 anchorMatrix = glm::rotate(orbitMatrix, glm::radians(globalRotations[i]), yAxis);
+        anchorMatrix = glm::translate(anchorMatrix, glm::dvec3(_distances[i], 0.0, 0.0));
+
+        _worldMatrices[i] = glm::rotate(anchorMatrix, glm::radians(localRotations[i]), yAxis);
+        _orbitMatrices[i] = glm::mat4(viewMatrix * orbitMatrix);
+        _anchorMatrices[i] = glm::mat4(viewMatrix * anchorMatrix);
+        _modelViewMatrices[i] = glm::mat4(viewMatrix * _worldMatrices[i]);
+    }
+
+    const glm::mat4 rootParentMatrix(viewMatrix);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Planet* body = _bodies[i];
+        body->_globalRotation = static_cast<float>(globalRotations[i]);
+        body->_localRotation = static_cast<float>(localRotations[i]);
+        body->_modelViewMatrix = _modelViewMatrices[i];
+
+        const glm::mat4& parentMatrix = _parents[i] < 0 ? rootParentMatrix : _modelViewMatrices[_parents[i]];
+        body->updateAttachments(elapsedTimeMs, parentMatrix, _orbitMatrices[i], _anchorMatrices[i]);
+    }
+}
+
+size_t FlatHierarchy::cull(const glm::mat4& projectionMatrix, float viewportHeight, bool zeroToOneDepth) const
+{
+    // Frustum planes in view space from the rows of the projection, inside where dot >= 0.
+    glm::vec4 rows[4];
+    for (int r = 0; r < 4; ++r)
+        rows[r] = glm::vec4(projectionMatrix[0][r], projectionMatrix[1][r], projectionMatrix[2][r], projectionMatrix[3][r]);
+
+    glm::vec4 candidates[6] = {
+        rows[3] + rows[0], rows[3] - rows[0],
+        rows[3] + rows[1], rows[3] - rows[1],
+        zeroToOneDepth ? rows[2] : rows[3] + rows[2], rows[3] - rows[2]
+    };
+    glm::vec4 planes[6];
+    int planeCount = 0;
+    for (const glm::vec4& plane : candidates)
+    {
+        // An infinite far plane has no normal and culls nothing.
+        float length = glm::length(glm::vec3(plane));
+        if (length > 1e-6f)
+            planes[planeCount++] = plane / length;
+    }
+
+    // Projected radius in pixels of a unit sphere at unit distance.
+    const float pixelScale = projectionMatrix[1][1] * viewportHeight * 0.5f;
+    const float minPixels = Config::cullPixelRadius;
+    const bool culling = Config::culling;
+
+    auto shown = [&](const glm::vec3& center, float radius) {
+        if (!culling)
+            return true;
+        for (int p = 0; p < planeCount; ++p)
+        {
+            if (glm::dot(glm::vec3(planes[p]), center) + planes[p].w < -radius)
+                return false;
+        }
+        float depth = -center.z;
+        return depth <= radius || radius * pixelScale >= minPixels * depth;
+    };
+
+    size_t visible = 0;
+    for (size_t i = 0; i < _bodies.size(); ++i)
+    {
+        Planet* body = _bodies[i];
+        const int parent = _parents[i];
+        const bool parentVisible = parent < 0 || _bodies[parent]->_subtreeVisible;
+        const glm::vec3 center(body->_modelViewMatrix[3]);
+
+        body->_subtreeVisible = parentVisible && shown(center, _subtreeRadii[i]);
+        body->_bodyVisible = body->_subtreeVisible && shown(center, _boundingRadii[i]);
+
+        // The orbit circles the parent, the path is drawn in eye space.
+        body->_orbitVisible = parentVisible
+                && (parent < 0 || shown(glm::vec3(_bodies[parent]->_modelViewMatrix[3]), static_cast<float>(_distances[i])));
+        body->_pathVisible = parentVisible && shown(glm::vec3(0.0f), _pathRadii[i]);
+
+        if (body->_bodyVisible)
+        {
+            float depth = -center.z;
+            float radiusPixels = body->_radius * pixelScale / depth;
+            body->_lod = depth > body->_radius
+                    ? SphereMesh::lodLevel(radiusPixels)
+                    : SphereMesh::s_lodLevels - 1;
+            // The impostor quad needs the eye well outside the sphere.
+            body->_impostor = Config::impostors && depth > 2.0f * body->_radius
+                    && radiusPixels < Config::impostorPixelRadius;
+        }
+
+        if (body->_bodyVisible)
+            ++visible;
+    }
+    return visible;
+}
+
+const std::vector<double>& FlatHierarchy::globalRotations() const
+{
+    return _globalRotations;
+}
+
+const std::vector<double>& FlatHierarchy::localRotations() const
+{
+    return _localRotations;
+}
+
+size_t FlatHierarchy::size() const
+{
+    return _bodies.size();
+}
@@ -0,0 +1,156 @@
+#ifndef FLATHIERARCHY_H
+#define FLATHIERARCHY_H
+
+#include <memory>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/mat4x4.hpp>
+
+class Planet;
+
+/**
+ * @brief The FlatHierarchy class is a data-oriented copy of the planet tree
+ *
+ * compile() flattens the tree below a root body into arrays ordered parents
+ * before children, so update() computes every model-view matrix in a single
+ * linear pass instead of recursing through Planet::update(). The bodies keep
+ * being drawn by the tree; update() writes the results back to them.
+ *
+ * Angles and transformation chains are kept in double precision relative to
+ * the root. Only the final matrices, multiplied with the view matrix and
+ * thereby relative to the camera, are converted to float for rendering, so
+ * bodies far from the root do not jitter.
+ *
+ * The tree must outlive the hierarchy, and compile() has to be called again
+ * whenever bodies are added or removed.
+ */
+class FlatHierarchy
+{
+public:
+    /**
+     * @brief The StepSettings struct is the part of Config that step() reads
+     *
+     * A copy, so a step on another thread does not read Config while the GUI
+     * thread writes it.
+     */
+    struct StepSettings
+    {
+        float animationSpeed = 1.0f;
+        bool localOrbits = true;           /**< Config::localOrbits, for the bodies below a sun */
+        bool globalRotation = true;        /**< Config::GlobalRotation */
+        bool localRotation = true;         /**< Config::localRotation */
+
+        /**
+         * @brief fromConfig Copies the current settings; call it on the GUI thread
+         */
+        static StepSettings fromConfig();
+    };
+
+    /**
+     * @brief compile Rebuilds the arrays from the tree below root
+     * @param root the top-level body, e.g. the earth
+     */
+    void compile(std::shared_ptr<Planet> root);
+
+    /**
+     * @brief update Advances all bodies and recomputes their matrices
+     * @param elapsedTimeMs the elapsed wall time in milliseconds
+     * @param modelViewMatrix the view matrix the root is placed in
+     */
+    void update(float elapsedTimeMs, const glm::mat4& modelViewMatrix);
+
+    /**
+     * @brief update Same as above, with the view matrix in double precision
+     */
+    void update(float elapsedTimeMs, const glm::dmat4& viewMatrix);
+
+    /**
+     * @brief step Advances the rotation angles only, without touching the bodies
+     *
+     * This is the simulation half of update(); it may run on another thread
+     * than evaluate() as long as the two do not run at the same time on the
+     * same angle arrays.
+     * @param elapsedTimeMs the simulated time step in milliseconds
+     * @param settings the animation speed and which rotations advance
+     */
+    void step(float elapsedTimeMs, const StepSettings& settings);
+
+    /**
+     * @brief evaluate Computes all matrices from the given angles and writes them back to the bodies
+     * @param elapsedTimeMs the elapsed time for the attachments, e.g. cloud animation
+     * @param viewMatrix the view matrix the root is placed in
+     * @param globalRotations the orbit angle of each body, e.g. interpolated between two steps
+     * @param localRotations the spin angle of each body
+     */
+    void evaluate(float elapsedTimeMs, const glm::dmat4& viewMatrix,
+                  const std::vector<double>& globalRotations, const std::vector<double>& localRotations);
+
+    /**
+     * @brief pullRotations Reloads the rotation angles from the bodies
+     *
+     * Needed after the recursive Planet::update() advanced the bodies
+     * instead of update(), e.g. while Config::flatHierarchy was off.
+     */
+    void pullRotations();
+
+    /**
+     * @brief globalRotations Getter for the orbit angles advanced by step()
+     */
+    const std::vector<double>& globalRotations() const;
+
+    /**
+     * @brief localRotations Getter for the spin angles advanced by step()
+     */
+    const std::vector<double>& localRotations() const;
+
+    /**
+     * @brief cull Decides which bodies, orbits and paths the next draw shows, and their level of detail
+     *
+     * Tests bounding spheres in view space, taken from the matrices of the
+     * last update, against the view frustum and drops everything whose
+     * projection is smaller than Config::cullPixelRadius. A body whose subtree
+     * (the body with its attachments, the orbits of its children and their
+     * subtrees) fails the test is skipped together with all its descendants.
+     * Without Config::culling everything stays visible. The sphere level of
+     * detail, and whether the body is drawn as an impostor, are chosen from
+     * the projected radius of every body either way.
+     * Only writes to the bodies, so it issues no GL calls.
+     * @param projectionMatrix the projection of the next draw
+     * @param viewportHeight the height of the viewport in pixels
+     * @param zeroToOneDepth whether clip space depth is [0, w] (glClipControl) instead of [-w, w]
+     * @return the number of bodies left visible
+     */
+    size_t cull(const glm::mat4& projectionMatrix, float viewportHeight, bool zeroToOneDepth) const;
+
+    /**
+     * @brief size Getter for the number of compiled bodies
+     * @return the number of bodies including the root
+     */
+    size_t size() const;
+
+private:
+    void append(Planet* body, int parent, bool belowSun);
+
+    std::vector<Planet*> _bodies;              /**< Back references for the write-back */
+    std::vector<int> _parents;                 /**< Index of the parent, -1 for the root */
+    std::vector<unsigned char> _belowSun;      /**< Orbits follow Config::localOrbits below a sun */
+
+    std::vector<double> _globalRotations;
+    std::vector<double> _globalRotationSpeeds;
+    std::vector<double> _localRotations;
+    std::vector<double> _localRotationSpeeds;
+    std::vector<double> _distances;
+    std::vector<double> _inclinations;
+
+    std::vector<float> _boundingRadii;         /**< Body with its attachments, see Planet::boundingRadius() */
+    std::vector<float> _subtreeRadii;          /**< Body with all descendants, around the body's center */
+    std::vector<float> _pathRadii;             /**< Path points lie within this distance of the eye space origin */
+
+    std::vector<glm::dmat4> _worldMatrices;    /**< Body transformations relative to the root */
+    std::vector<glm::mat4> _orbitMatrices;     /**< Parent matrix including the inclination */
+    std::vector<glm::mat4> _anchorMatrices;    /**< Body position before its own spin */
+    std::vector<glm::mat4> _modelViewMatrices; /**< Final matrices, parents for the children */
+};
+
+#endif // FLATHIERARCHY_H
@@ -0,0 +1,126 @@
+#include <GL/glew.h>
+#include "planets/impostorbatch.h"
+
+#include <cstddef>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "glbase/gltool.hpp"
+#include "planets/scene.h"
+
+#include <QDebug>
+
+ImpostorBatch::ImpostorBatch(std::string name):
+    Drawable(name)
+{
+    qDebug() << "ImpostorBatch constructor called for:" << QString::fromStdString(_name);
+}
+
+ImpostorBatch::~ImpostorBatch()
+{
+    if (_instanceBuffer != 0)
+        glDeleteBuffers(1, &_instanceBuffer);
+}
+
+void ImpostorBatch::add(const BodyBatch::Instance& instance)
+{
+    _instances.push_back(instance);
+}
+
+bool ImpostorBatch::empty() const
+{
+    return _instances.empty();
+}
+
+void ImpostorBatch::draw(glm::mat4 projection_matrix) const
+{
+    if (_instances.empty())
+        return;
+
+    if (_program == 0 || _instanceBuffer == 0)
+    {
+        qDebug() << "ImpostorBatch" << QString::fromStdString(_name) << "not initialized. Call init() first.";
+        _instances.clear();
+        return;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, _instances.size() * sizeof(BodyBatch::Instance), _instances.data(), GL_STREAM_DRAW);
+
+    glUseProgram(_program);
+    glUniform1i(uniform(U_HAS_CLOUDS), 0);
+    setLightUniforms(_sun, _laser);
+    glUniformMatrix4fv(uniform(U_PROJECTION_MATRIX), 1, GL_FALSE, glm::value_ptr(projection_matrix));
+
+    glBindVertexArray(_vertexArrayObject);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(_instances.size()));
+    glBindVertexArray(0);
+
+    _instances.clear();
+    VERIFY(CG::checkError());
+}
+
+void ImpostorBatch::update(float elapsedTimeMs, glm::mat4 modelViewMatrix)
+{
+}
+
+void ImpostorBatch::setLights(std::shared_ptr<Sun> sun, std::shared_ptr<Cone> laser)
+{
+    qDebug() << "ImpostorBatch::setLights() called for:" << QString::fromStdString(_name);
+    _sun = sun;
+    _laser = laser;
+}
+
+void ImpostorBatch::createObject()
+{
+    qDebug() << "ImpostorBatch::createObject() called for:" << QString::fromStdString(_name);
+    if (_vertexArrayObject != 0)
+        return;
+
+    // The quad corners come from gl_VertexID; only the instance attributes are read from a buffer.
+    glGenBuffers(1, &_instanceBuffer);
+    glGenVertexArrays(1, &_vertexArrayObject);
+    glBindVertexArray(_vertexArrayObject);
+    glBindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+
+    const GLsizei stride = sizeof(BodyBatch::Instance);
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        size_t offset = offsetof(BodyBatch::Instance, modelViewMatrix) + column * sizeof(glm::vec4);
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset));
+    }
+    glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<const void*>(offsetof(BodyBatch::Instance, radius)));
+    glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<const void*>(offsetof(BodyBatch::Instance, textureLayer)));
+    for (GLuint i = 3; i <= 8; ++i)
+    {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+    glBindVertexArray(0);
+    VERIFY(CG::checkError());
+}
+
+std::string ImpostorBatch::getVertexShader() const
+{
+    return Drawable::loadShaderFile(":/shader/impostor.vs.glsl");
+}
+
+std::string ImpostorBatch::getFragmentShader() const
+{
+    // The phong shader of the batched bodies, fed by the ray cast instead of the vertex shader.
+    std::string source = BodyBatch::layeredFragmentShader(Drawable::loadShaderFile(":/shader/phong.fs.glsl"));
+    source = CG::replace(source, "in vec2 vTexCoord;", "vec2 vTexCoord;\nvec2 vTexCoordDx;\nvec2 vTexCoordDy;");
+    source = CG::replace(source, "in vec3 vNormalView;", "vec3 vNormalView;");
+    source = CG::replace(source, "in vec3 vFragPosView;", "vec3 vFragPosView;");
+    source = CG::replace(source, "texture(uTextureSampler, vec3(vTexCoord, vLayer))",
+                         "textureGrad(uTextureSampler, vec3(vTexCoord, vLayer), vTexCoordDx, vTexCoordDy)");
+    source = CG::replace(source, "void main()", "void shade()");
+    return source + "\n" + Drawable::loadShaderFile(":/shader/impostor.fs.glsl");
+}
+
+std::string ImpostorBatch::getShaderDefines() const
+{
+    return Scene::reversedDepth() ? "#define ZERO_TO_ONE_DEPTH 1\n" : "";
+}
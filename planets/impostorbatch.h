@@ -0,0 +1,68 @@
+#ifndef IMPOSTORBATCH_H
+#define IMPOSTORBATCH_H
+
+#include "planets/bodybatch.h"
+
+#include <memory>
+#include <vector>
+
+class Sun;
+class Cone;
+
+/**
+ * @brief The ImpostorBatch class draws small bodies as ray-cast spheres
+ *
+ * Each queued body becomes one screen-aligned quad that just covers its
+ * projection. The fragment shader intersects the view ray with the sphere
+ * and writes the depth, normal and texture coordinates of the hit into the
+ * phong shader of the BodyBatch. The spheres are exact at four vertices per
+ * body, whatever their projected size. FlatHierarchy::cull() picks the
+ * bodies by their projected radius, see Config::impostorPixelRadius.
+ *
+ * The batch belongs to a BodyBatch, which queues the bodies with
+ * addImpostor() and draws them with its texture array bound.
+ */
+class ImpostorBatch : public Drawable
+{
+public:
+    ImpostorBatch(std::string name = "IMPOSTOR BATCH");
+
+    virtual ~ImpostorBatch();
+
+    /**
+     * @brief add Queues a body for the next draw()
+     * @param instance the model-view matrix, radius and texture layer of the body
+     */
+    void add(const BodyBatch::Instance& instance);
+
+    /**
+     * @brief empty Returns true if no body is queued
+     */
+    bool empty() const;
+
+    /**
+     * @brief draw Draws and clears all queued bodies; expects the texture array on unit 0
+     * @param projection_matrix the current projection matrix
+     */
+    virtual void draw(glm::mat4 projection_matrix) const override;
+
+    virtual void update(float elapsedTimeMs, glm::mat4 modelViewMatrix) override;
+
+    virtual void setLights(std::shared_ptr<Sun> sun, std::shared_ptr<Cone> laser);
+
+protected:
+    virtual void createObject() override;
+    virtual std::string getVertexShader() const override;
+    virtual std::string getFragmentShader() const override;
+    virtual std::string getShaderDefines() const override;
+
+    GLuint _instanceBuffer = 0;
+
+    // Filled by the bodies during their const draw().
+    mutable std::vector<BodyBatch::Instance> _instances;
+
+    std::shared_ptr<Sun> _sun;
+    std::shared_ptr<Cone> _laser;
+};
+
+#endif // IMPOSTORBATCH_H
@@ -0,0 +1,61 @@
+#include "planets/meshdata.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include <glm/packing.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/vec4.hpp>
+
+namespace {
+    // Only changed on the GL thread, by the uploaders.
+    long long s_bufferBytes = 0;
+}
+
+void MeshData::pack()
+{
+    if (packed())
+        return;
+
+    vertices.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        vertices[i].position = positions[i];
+        vertices[i].normal = glm::packSnorm3x10_1x2(glm::vec4(normals[i], 0.0f));
+        vertices[i].texCoord = glm::packHalf2x16(texCoords[i]);
+    }
+
+    if (positions.size() <= 65536)
+    {
+        shortIndices.assign(indices.begin(), indices.end());
+        std::vector<unsigned int>().swap(indices);
+    }
+
+    std::vector<glm::vec3>().swap(positions);
+    std::vector<glm::vec3>().swap(normals);
+    std::vector<glm::vec2>().swap(texCoords);
+}
+
+void MeshData::setupAttributes()
+{
+    const GLsizei stride = sizeof(PackedVertex);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<const void*>(offsetof(PackedVertex, position)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride,
+                          reinterpret_cast<const void*>(offsetof(PackedVertex, normal)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<const void*>(offsetof(PackedVertex, texCoord)));
+    glEnableVertexAttribArray(2);
+}
+
+void MeshData::countBufferBytes(long long bytes)
+{
+    s_bufferBytes += bytes;
+}
+
+size_t MeshData::bufferBytes()
+{
+    return static_cast<size_t>(std::max(s_bufferBytes, 0ll));
+}
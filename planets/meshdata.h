@@ -0,0 +1,106 @@
+#ifndef MESHDATA_H
+#define MESHDATA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+/**
+ * @brief The PackedVertex struct is the interleaved vertex format of all procedural meshes
+ *
+ * 20 bytes instead of 32 for three float attributes: the position as floats,
+ * the normal as GL_INT_2_10_10_10_REV and the texture coordinates as half
+ * floats. These are not clamped to [0, 1]: the seam vertices of the
+ * icosphere and cube sphere go past 1 and rely on GL_REPEAT.
+ */
+struct PackedVertex
+{
+    glm::vec3 position;
+    uint32_t normal;
+    uint32_t texCoord;
+};
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must be packed");
+
+/**
+ * @brief The MeshData struct holds generated geometry on the CPU
+ *
+ * Builders fill positions, normals and texture coordinates, for the attribute
+ * locations 0, 1 and 2, and indices describing GL_TRIANGLES. They call
+ * reserve() with the exact sizes first, so filling the arrays never
+ * reallocates. pack() then converts everything to the upload format. The
+ * struct has no GL objects and can be built and packed on any thread.
+ * The classes that upload packed meshes report their buffer sizes with
+ * countBufferBytes(), so bufferBytes() tells the GPU memory they take.
+ */
+struct MeshData
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<unsigned int> indices;
+
+    // Filled by pack(), which empties the arrays above except for 'indices'
+    // when they do not fit into 16 bits.
+    std::vector<PackedVertex> vertices;
+    std::vector<uint16_t> shortIndices;
+
+    void reserve(size_t vertexCount, size_t indexCount)
+    {
+        positions.reserve(vertexCount);
+        normals.reserve(vertexCount);
+        texCoords.reserve(vertexCount);
+        indices.reserve(indexCount);
+    }
+
+    /**
+     * @brief pack Interleaves the vertices and narrows the indices to 16 bits if possible
+     */
+    void pack();
+
+    bool packed() const { return !vertices.empty(); }
+
+    bool empty() const { return indices.empty() && shortIndices.empty(); }
+
+    size_t indexCount() const { return shortIndices.empty() ? indices.size() : shortIndices.size(); }
+
+    GLenum indexType() const { return shortIndices.empty() ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT; }
+
+    const void* indexData() const
+    {
+        return shortIndices.empty() ? static_cast<const void*>(indices.data()) : shortIndices.data();
+    }
+
+    size_t indexBytes() const
+    {
+        return shortIndices.empty() ? indices.size() * sizeof(unsigned int) : shortIndices.size() * sizeof(uint16_t);
+    }
+
+    /**
+     * @brief setupAttributes Points the attributes 0 to 2 of the bound vertex array at
+     *        packed vertices in the bound GL_ARRAY_BUFFER
+     */
+    static void setupAttributes();
+
+    /**
+     * @brief countBufferBytes Records allocated (positive) or freed (negative) buffer memory
+     */
+    static void countBufferBytes(long long bytes);
+
+    /**
+     * @brief bufferBytes Returns the bytes of all buffers holding packed meshes
+     */
+    static size_t bufferBytes();
+};
+
+#endif // MESHDATA_H
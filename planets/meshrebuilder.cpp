@@ -0,0 +1,114 @@
+#include "planets/meshrebuilder.h"
+
+#include <algorithm>
+
+#include <QRunnable>
+#include <QThread>
+#include <QDebug>
+
+class BuildTask : public QRunnable
+{
+public:
+    BuildTask(MeshRebuilder* rebuilder, unsigned int generation, std::shared_ptr<MeshRebuilder::Result> result):
+        _rebuilder(rebuilder), _generation(generation), _result(result)
+    {
+    }
+
+    virtual void run() override
+    {
+        // A task of a dropped generation may already have been taken by a worker; skip its build.
+        if (_result->build && !_rebuilder->stale(_generation))
+        {
+            _result->build(_result->mesh);
+            _result->mesh.pack();
+        }
+        _rebuilder->finished(_generation);
+    }
+
+private:
+    MeshRebuilder* _rebuilder;
+    unsigned int _generation;
+    std::shared_ptr<MeshRebuilder::Result> _result;
+};
+
+MeshRebuilder::MeshRebuilder()
+{
+    _pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() - 1));
+}
+
+MeshRebuilder::~MeshRebuilder()
+{
+    _pool.waitForDone();
+}
+
+void MeshRebuilder::begin()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_jobs.empty())
+        qDebug() << "MeshRebuilder: dropping" << _jobs.size() << "jobs of an unfinished rebuild.";
+    _jobs.clear();
+    // Tasks of the dropped generation that no worker has started are removed unrun.
+    _pool.clear();
+    _generation++;
+    _remaining = 0;
+    _clock.start();
+}
+
+void MeshRebuilder::add(BuildFunction build, ApplyFunction apply)
+{
+    Job job;
+    job.result = std::make_shared<Result>();
+    job.result->build = std::move(build);
+    job.apply = std::move(apply);
+
+    unsigned int generation;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        generation = _generation;
+        _remaining++;
+    }
+    _jobs.push_back(job);
+    _pool.start(new BuildTask(this, generation, job.result));
+}
+
+void MeshRebuilder::finished(unsigned int generation)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (generation == _generation && _remaining > 0)
+        _remaining--;
+}
+
+bool MeshRebuilder::stale(unsigned int generation) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return generation != _generation;
+}
+
+bool MeshRebuilder::processFinished()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_jobs.empty() || _remaining > 0)
+            return false;
+    }
+
+    // All results are complete and no worker touches them any more.
+    std::vector<Job> jobs;
+    jobs.swap(_jobs);
+    for (const Job& job : jobs)
+        job.apply(job.result->mesh);
+
+    _lastBuildMs = _clock.nsecsElapsed() / 1.0e6;
+    qDebug() << "MeshRebuilder: applied" << jobs.size() << "meshes" << _lastBuildMs << "ms after the request.";
+    return true;
+}
+
+bool MeshRebuilder::pending() const
+{
+    return !_jobs.empty();
+}
+
+double MeshRebuilder::lastBuildMilliseconds() const
+{
+    return _lastBuildMs;
+}
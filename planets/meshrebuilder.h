@@ -0,0 +1,101 @@
+#ifndef MESHREBUILDER_H
+#define MESHREBUILDER_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QThreadPool>
+
+#include "planets/meshdata.h"
+
+/**
+ * @brief The MeshRebuilder class regenerates geometry on worker threads
+ *
+ * A rebuild is a generation of jobs started with begin() and filled with
+ * add(). Each job builds and packs a MeshData on the thread pool and is applied on the
+ * GL thread by processFinished(), but only once every job of the generation
+ * is done, so the new geometry replaces the old in a single frame. Starting
+ * a new generation drops the unfinished one.
+ *
+ * Build functions run concurrently on other threads: they must only use the
+ * values they captured, never the drawables. Apply functions run on the GL
+ * thread and may hold the drawables.
+ */
+class MeshRebuilder
+{
+public:
+    typedef std::function<void(MeshData& mesh)> BuildFunction;
+    typedef std::function<void(const MeshData& mesh)> ApplyFunction;
+
+    MeshRebuilder();
+
+    /**
+     * @brief ~MeshRebuilder Waits for the running jobs; call on the GL thread
+     */
+    ~MeshRebuilder();
+
+    /**
+     * @brief begin Starts a new generation and drops the pending one
+     */
+    void begin();
+
+    /**
+     * @brief add Queues a job of the current generation
+     * @param build fills the mesh on a worker thread; may be empty if there is nothing to build
+     * @param apply called on the GL thread with the built mesh
+     */
+    void add(BuildFunction build, ApplyFunction apply);
+
+    /**
+     * @brief processFinished Applies the current generation if all its jobs are done; call on the GL thread
+     * @return true if a generation was applied
+     */
+    bool processFinished();
+
+    /**
+     * @brief pending Whether a generation waits for its jobs
+     */
+    bool pending() const;
+
+    /**
+     * @brief lastBuildMilliseconds Getter for the time from begin() to the application of the last generation
+     */
+    double lastBuildMilliseconds() const;
+
+private:
+    MeshRebuilder(const MeshRebuilder&) = delete;
+    MeshRebuilder& operator=(const MeshRebuilder&) = delete;
+
+    // Shared with the worker; holds no references to drawables.
+    struct Result
+    {
+        BuildFunction build;
+        MeshData mesh;
+    };
+
+    struct Job
+    {
+        std::shared_ptr<Result> result;
+        ApplyFunction apply;
+    };
+
+    friend class BuildTask;
+
+    void finished(unsigned int generation);
+    bool stale(unsigned int generation) const;
+
+    QThreadPool _pool;
+    QElapsedTimer _clock;
+    double _lastBuildMs = 0.0;
+
+    std::vector<Job> _jobs;                    // GL thread only
+
+    mutable std::mutex _mutex;
+    unsigned int _generation = 0;              // guarded by _mutex
+    unsigned int _remaining = 0;               // guarded by _mutex
+};
+
+#endif // MESHREBUILDER_H
@@ -6,14 +6,21 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <vector>
 #include <iostream>
 
 #include "glbase/gltool.hpp"
 #include "gui/config.h"
+#include "planets/meshdata.h"
 
 #include <QDebug>
 
+namespace {
+    // Half the width of the drawn orbit band.
+    const float s_ringWidth = 0.02f;
+}
+
 Orbit::Orbit(std::string name, float radius):
     Drawable(name),
     _radius(radius)
@@ -35,12 +42,22 @@ void Orbit::draw(glm::mat4 projection_matrix) const
 
     glBindVertexArray(_vertexArrayObject);
 
-    glUniformMatrix4fv(glGetUniformLocation(_program, "projection_matrix"), 1, GL_FALSE, glm::value_ptr(projection_matrix));
-    glUniformMatrix4fv(glGetUniformLocation(_program, "modelview_matrix"), 1, GL_FALSE, glm::value_ptr(_modelViewMatrix));
+    glUniformMatrix4fv(uniform(U_PROJECTION_MATRIX), 1, GL_FALSE, glm::value_ptr(projection_matrix));
+    glUniformMatrix4fv(uniform(U_MODELVIEW_MATRIX), 1, GL_FALSE, glm::value_ptr(_modelViewMatrix));
 
-    glUniform3f(glGetUniformLocation(_program, "uColor"), 1.0f, 0.0f, 0.0f);
+    glUniform3f(uniform(U_COLOR), 1.0f, 0.0f, 0.0f);
 
-    glDrawElements(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, 0);
+    if (Config::proceduralMeshes)
+    {
+        glUniform1i(uniform(U_SEGMENTS), _resolutionSegments);
+        glUniform1f(uniform(U_INNER_RADIUS), _radius - s_ringWidth);
+        glUniform1f(uniform(U_OUTER_RADIUS), _radius + s_ringWidth);
+        glDrawArrays(GL_TRIANGLES, 0, 6 * _resolutionSegments);
+    }
+    else
+    {
+        glDrawElements(GL_TRIANGLES, _indexCount, _indexType, 0);
+    }
 
     glBindVertexArray(0);
 
@@ -54,7 +71,8 @@ void Orbit::update(float elapsedTimeMs, glm::mat4 modelViewMatrix)
 
 std::string Orbit::getVertexShader() const
 {
-   return Drawable::loadShaderFile(":/shader/simple.vs.glsl");
+    std::string source = Drawable::loadShaderFile(":/shader/simple.vs.glsl");
+    return Config::proceduralMeshes ? proceduralVertexShader(source) : source;
 }
 
 std::string Orbit::getFragmentShader() const
@@ -62,80 +80,55 @@ std::string Orbit::getFragmentShader() const
     return Drawable::loadShaderFile(":/shader/simple.fs.glsl");
 }
 
-void Orbit::createObject()
+std::string Orbit::getShaderDefines() const
 {
-    qDebug() << "Orbit::createObject() called for:" << QString::fromStdString(_name);
-    unsigned int segments = _resolutionSegments;
-    if (segments < 3) segments = 3;
-
-    float ringWidth = 0.02f;
-    float innerRadius = _radius - ringWidth;
-    float outerRadius = _radius + ringWidth;
-
-
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> texCoords;
-    std::vector<unsigned int> indices;
-
-    for (unsigned int i = 0; i < segments; ++i)
-    {
-        float angle = (float)i / segments * 2.0f * glm::pi<float>();
-        float cosA = cos(angle);
-        float sinA = sin(angle);
-        glm::vec3 innerPos = glm::vec3(cosA * innerRadius, 0.0f, sinA * innerRadius);
-        glm::vec3 outerPos = glm::vec3(cosA * outerRadius, 0.0f, sinA * outerRadius);
-        positions.push_back(innerPos);
-        positions.push_back(outerPos);
-        glm::vec3 normal = glm::vec3(0.0f, 1.0f, 0.0f);
-        normals.push_back(normal);
-        normals.push_back(normal);
-        texCoords.push_back(glm::vec2((float)i / segments, 0.0f));
-        texCoords.push_back(glm::vec2((float)i / segments, 1.0f));
-        unsigned int i0 = i * 2;
-        unsigned int i1 = i * 2 + 1;
-        unsigned int i2 = ((i + 1) % segments) * 2;
-        unsigned int i3 = ((i + 1) % segments) * 2 + 1;
-        indices.push_back(i0);
-        indices.push_back(i2);
-        indices.push_back(i1);
-        indices.push_back(i1);
-        indices.push_back(i2);
-        indices.push_back(i3);
-    }
-
-    _indexCount = static_cast<unsigned int>(indices.size());
-
-    if(_vertexArrayObject == 0)
-        glGenVertexArrays(1, &_vertexArrayObject);
-    glBindVertexArray(_vertexArrayObject);
+    return Config::proceduralMeshes ? "#define PROCEDURAL_ANNULUS 1\n" : "";
+}
 
-    if (_positionBuffer == 0)
-        glGenBuffers(1, &_positionBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, _positionBuffer);
-    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
-
-    if (_normalBuffer == 0)
-        glGenBuffers(1, &_normalBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, _normalBuffer);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(1);
-
-    if (_texCoordBuffer == 0)
-        glGenBuffers(1, &_texCoordBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, _texCoordBuffer);
-    glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), texCoords.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(2);
-
-    if (_indexBuffer == 0)
-        glGenBuffers(1, &_indexBuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+std::function<void(MeshData&)> Orbit::meshBuilder(unsigned int segments) const
+{
+    if (Config::proceduralMeshes)
+        return nullptr;
+
+    float radius = _radius;
+    return [radius, segments](MeshData& mesh) {
+        unsigned int count = std::max(segments, 3u);
+
+        float innerRadius = radius - s_ringWidth;
+        float outerRadius = radius + s_ringWidth;
+
+        mesh.reserve(2 * count, 6 * count);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            float angle = (float)i / count * 2.0f * glm::pi<float>();
+            float cosA = cos(angle);
+            float sinA = sin(angle);
+            mesh.positions.push_back(glm::vec3(cosA * innerRadius, 0.0f, sinA * innerRadius));
+            mesh.positions.push_back(glm::vec3(cosA * outerRadius, 0.0f, sinA * outerRadius));
+            glm::vec3 normal = glm::vec3(0.0f, 1.0f, 0.0f);
+            mesh.normals.push_back(normal);
+            mesh.normals.push_back(normal);
+            mesh.texCoords.push_back(glm::vec2((float)i / count, 0.0f));
+            mesh.texCoords.push_back(glm::vec2((float)i / count, 1.0f));
+            unsigned int i0 = i * 2;
+            unsigned int i1 = i * 2 + 1;
+            unsigned int i2 = ((i + 1) % count) * 2;
+            unsigned int i3 = ((i + 1) % count) * 2 + 1;
+            mesh.indices.push_back(i0);
+            mesh.indices.push_back(i2);
+            mesh.indices.push_back(i1);
+            mesh.indices.push_back(i1);
+            mesh.indices.push_back(i2);
+            mesh.indices.push_back(i3);
+        }
+    };
+}
 
-    glBindVertexArray(0);
-    VERIFY(CG::checkError());
-}
\ No newline at end of file
+void Orbit::createObject()
+{
+    qDebug() << "Orbit::createObject() called for:" << QString::fromStdString(_name);
+    if (Config::proceduralMeshes)
+        createProceduralMesh();
+    else
+        createMesh();
+}
@@ -13,15 +13,18 @@ public:
 
     virtual void update(float elapsedTimeMs, glm::mat4 modelViewMatrix) override;
 
+    virtual std::function<void(MeshData&)> meshBuilder(unsigned int segments) const override;
+
 protected:
     virtual std::string getVertexShader() const override;
 
     virtual std::string getFragmentShader() const override;
 
+    virtual std::string getShaderDefines() const override;
+
     virtual void createObject() override;
 
     float _radius;
-    unsigned int _indexCount = 0;
 };
 
 #endif // ORBIT_H
\ No newline at end of file
@@ -27,10 +27,10 @@ void Path::draw(glm::mat4 projection_matrix) const
     glUseProgram(_program);
     glBindVertexArray(_vertexArrayObject);
 
-    glUniformMatrix4fv(glGetUniformLocation(_program, "projection_matrix"), 1, GL_FALSE, glm::value_ptr(projection_matrix));
-    glUniformMatrix4fv(glGetUniformLocation(_program, "modelview_matrix"), 1, GL_FALSE, glm::value_ptr(_modelViewMatrix));
+    glUniformMatrix4fv(uniform(U_PROJECTION_MATRIX), 1, GL_FALSE, glm::value_ptr(projection_matrix));
+    glUniformMatrix4fv(uniform(U_MODELVIEW_MATRIX), 1, GL_FALSE, glm::value_ptr(_modelViewMatrix));
 
-    glUniform4f(glGetUniformLocation(_program, "uColor"), 1.0f, 1.0f, 1.0f, 1.0f);
+    glUniform4f(uniform(U_COLOR), 1.0f, 1.0f, 1.0f, 1.0f);
 
     glDrawArrays(GL_LINE_STRIP, 0, _vertexCount);
 
@@ -53,9 +53,9 @@ void Path::createObject()
         glGenVertexArrays(1, &_vertexArrayObject);
     glBindVertexArray(_vertexArrayObject);
 
-    GLuint position_buffer;
-    glGenBuffers(1, &position_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, position_buffer);
+    if (_vertexBuffer == 0)
+        glGenBuffers(1, &_vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
     glBufferData(GL_ARRAY_BUFFER, _positions.size() * sizeof(glm::vec3), _positions.data(), GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
@@ -75,6 +75,11 @@ void Path::addPosition(glm::vec3 position)
     _positions.push_back(position);
 }
 
+void Path::setPositions(std::vector<glm::vec3> positions)
+{
+    _positions = std::move(positions);
+}
+
 std::string Path::getVertexShader() const
 {
     return Drawable::loadShaderFile(":/shader/path.vs.glsl");
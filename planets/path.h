@@ -18,6 +18,8 @@ public:
 
     virtual void addPosition(glm::vec3 position);
 
+    virtual void setPositions(std::vector<glm::vec3> positions);
+
 protected:
 
     virtual std::string getVertexShader() const override;
@@ -9,17 +9,24 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <queue>
 #include <stack>
 #include <vector>
 
 #include "glbase/gltool.hpp"
 #include "gui/config.h"
+#include "planets/bodybatch.h"
 #include "planets/cone.h"
+#include "planets/meshdata.h"
+#include "planets/meshrebuilder.h"
 #include "planets/sun.h"
 #include "planets/orbit.h"
 #include "planets/path.h"
 #include "planets/ring.h"
+#include "planets/spheremesh.h"
+#include "planets/texturecache.h"
 
 #include <QDebug>
 
@@ -66,7 +73,15 @@ void Planet::init()
     if (_ring)
         _ring->init();
 
-    if (!_textureLocation.empty())
+    releaseTexture(_textureID);
+    releaseTexture(_cloudTextureID);
+
+    if (!_textureLocation.empty() && Config::instancedBodies && _bodyBatch && isInstanceable())
+    {
+        // Batched bodies sample the shared texture array instead.
+        _textureLayer = _bodyBatch->addTexture(_textureLocation);
+    }
+    else if (!_textureLocation.empty())
     {
         _textureID = loadTexture(_textureLocation);
         if (_textureID == 0)
@@ -110,71 +125,76 @@ void Planet::recreate()
 
 void Planet::draw(glm::mat4 projection_matrix) const
 {
-    _orbit->draw(projection_matrix);
-    _path->draw(projection_matrix);
+    if (_orbitVisible)
+        _orbit->draw(projection_matrix);
+    if (_pathVisible)
+        _path->draw(projection_matrix);
+    if (!_subtreeVisible)
+        return;
     for (const auto& child : _children)
     {
         child->draw(projection_matrix);
     }
 
-    if(_program == 0){
+    if (!_bodyVisible)
+        return;
+
+    if(_program == 0 || (!_sphere && !Config::proceduralMeshes)){
         qDebug() << "Planet" << QString::fromStdString(_name) << "not initialized. Call init() first.";
         return;
     }
 
+    const std::shared_ptr<SphereMesh>& sphere = _lodMeshes.empty()
+            ? _sphere : _lodMeshes[std::min<size_t>(_lod, _lodMeshes.size() - 1)];
+
+    if (_textureLayer >= 0 && Config::instancedBodies)
+    {
+        if (_impostor)
+            _bodyBatch->addImpostor(_modelViewMatrix, _radius, _textureLayer);
+        else if (Config::proceduralMeshes)
+            _bodyBatch->add(proceduralSegments(), _modelViewMatrix, _radius, _textureLayer);
+        else
+            _bodyBatch->add(sphere, _modelViewMatrix, _radius, _textureLayer);
+        return;
+    }
+
     glUseProgram(_program);
-    glBindVertexArray(_vertexArrayObject);
+    if (Config::proceduralMeshes)
+        glBindVertexArray(_vertexArrayObject);
+    else
+        sphere->bind();
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, _textureID);
-    glUniform1i(glGetUniformLocation(_program, "uTextureSampler"), 0);
 
     bool hasClouds = (_cloudTextureID != 0);
     if (hasClouds)
     {
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, _cloudTextureID);
-        glUniform1i(glGetUniformLocation(_program, "uCloudSampler"), 1);
     }
-    glUniform1i(glGetUniformLocation(_program, "uHasClouds"), hasClouds);
+    glUniform1i(uniform(U_HAS_CLOUDS), hasClouds);
 
     float timeInSeconds = _totalTimeMs / 1000.0f;
-    glUniform1f(glGetUniformLocation(_program, "uTime"), timeInSeconds);
+    glUniform1f(uniform(U_TIME), timeInSeconds);
 
-    glm::vec3 lightPosView = glm::vec3(0.0f, 0.0f, 0.0f);
-    glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+    setLightUniforms(_sun, _laser);
 
-    if (Config::sunLight && _sun)
+    glUniformMatrix4fv(uniform(U_PROJECTION_MATRIX), 1, GL_FALSE, glm::value_ptr(projection_matrix));
+    glm::mat4 modelViewMatrix = glm::scale(_modelViewMatrix, glm::vec3(_radius));
+    glUniformMatrix4fv(uniform(U_MODELVIEW_MATRIX), 1, GL_FALSE, glm::value_ptr(modelViewMatrix));
+
+    if (Config::proceduralMeshes)
     {
-        lightPosView = _sun->getPosition();
-        lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+        unsigned int segments = proceduralSegments();
+        glUniform1i(uniform(U_SEGMENTS), segments);
+        glDrawArrays(GL_TRIANGLES, 0, 6 * segments * segments);
     }
-
-    glUniform3fv(glGetUniformLocation(_program, "uLightPosView"), 1, glm::value_ptr(lightPosView));
-    glUniform3fv(glGetUniformLocation(_program, "uLightColor"), 1, glm::value_ptr(lightColor));
-
-    bool hasLaser = (_laser != nullptr);
-    glUniform1i(glGetUniformLocation(_program, "uHasLaser"), hasLaser);
-    if (hasLaser)
+    else
     {
-        glm::vec3 laserPosView = _laser->getPosition();
-        glm::vec3 laserDirView = _laser->getDirection();
-
-        float cutoffAngleRad = glm::radians(Config::laserCutoff);
-        float cutoffCos = cos(cutoffAngleRad);
-
-        glUniform3fv(glGetUniformLocation(_program, "uLaserPosView"), 1, glm::value_ptr(laserPosView));
-        glUniform3fv(glGetUniformLocation(_program, "uLaserDirView"), 1, glm::value_ptr(laserDirView));
-        glUniform1f(glGetUniformLocation(_program, "uLaserCutoffCos"), cutoffCos);
-
-        glUniform3f(glGetUniformLocation(_program, "uLaserColor"), 1.0f, 0.0f, 0.0f);
+        glDrawElements(GL_TRIANGLES, sphere->indexCount(), sphere->indexType(), 0);
     }
 
-    glUniformMatrix4fv(glGetUniformLocation(_program, "projection_matrix"), 1, GL_FALSE, glm::value_ptr(projection_matrix));
-    glUniformMatrix4fv(glGetUniformLocation(_program, "modelview_matrix"), 1, GL_FALSE, glm::value_ptr(_modelViewMatrix));
-
-    glDrawElements(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, 0);
-
     glBindVertexArray(0);
 
     if (hasClouds)
@@ -254,6 +274,18 @@ void Planet::update(float elapsedTimeMs, glm::mat4 modelViewMatrix)
     }
 }
 
+void Planet::updateAttachments(float elapsedTimeMs, const glm::mat4& parentMatrix,
+                               const glm::mat4& orbitMatrix, const glm::mat4& anchorMatrix)
+{
+    _totalTimeMs += elapsedTimeMs;
+
+    _orbit->update(elapsedTimeMs, orbitMatrix);
+    _path->update(elapsedTimeMs, parentMatrix);
+
+    if (_ring)
+        _ring->update(elapsedTimeMs, anchorMatrix);
+}
+
 void Planet::setResolution(unsigned int segments)
 {
     qDebug() << "Planet::setResolution() called for:" << QString::fromStdString(_name) << "with segments:" << segments;
@@ -271,6 +303,39 @@ void Planet::setResolution(unsigned int segments)
     }
 }
 
+void Planet::requestResolution(unsigned int segments, MeshRebuilder& rebuilder)
+{
+    if (_orbit)
+        requestMesh(rebuilder, _orbit, segments);
+
+    if (_ring)
+        requestMesh(rebuilder, _ring, segments);
+
+    for (const auto& child : _children)
+    {
+        child->requestResolution(segments, rebuilder);
+    }
+}
+
+void Planet::applySphereResolution(unsigned int segments)
+{
+    _resolutionSegments = std::max(segments, 3u);
+    createObject();
+
+    for (const auto& child : _children)
+    {
+        child->applySphereResolution(segments);
+    }
+}
+
+void Planet::requestMesh(MeshRebuilder& rebuilder, const std::shared_ptr<Drawable>& drawable, unsigned int segments)
+{
+    std::shared_ptr<Drawable> target = drawable;
+    rebuilder.add(drawable->meshBuilder(segments), [target, segments](const MeshData& mesh) {
+        target->applyMesh(segments, mesh);
+    });
+}
+
 void Planet::setLights(std::shared_ptr<Sun> sun, std::shared_ptr<Cone> laser)
 {
     qDebug() << "Planet::setLights() called for:" << QString::fromStdString(_name);
@@ -284,6 +349,26 @@ void Planet::setLights(std::shared_ptr<Sun> sun, std::shared_ptr<Cone> laser)
         child->setLights(sun, laser);
 }
 
+void Planet::setBodyBatch(std::shared_ptr<BodyBatch> batch)
+{
+    qDebug() << "Planet::setBodyBatch() called for:" << QString::fromStdString(_name);
+    _bodyBatch = batch;
+
+    for(auto child : _children)
+        child->setBodyBatch(batch);
+}
+
+bool Planet::isInstanceable() const
+{
+    // Clouds need their own sampler, and rings must be blended after the body.
+    return _cloudTextureLocation.empty() && !_ring;
+}
+
+float Planet::boundingRadius() const
+{
+    return _ring ? std::max(_radius, _ring->outerRadius()) : _radius;
+}
+
 void Planet::setRing(std::shared_ptr<Ring> ring)
 {
     qDebug() << "Planet::setRing() called for:" << QString::fromStdString(_name);
@@ -299,86 +384,45 @@ void Planet::addChild(std::shared_ptr<Planet> child)
 
 void Planet::createObject(){
     qDebug() << "Planet::createObject() called for:" << QString::fromStdString(_name);
-    unsigned int latitudeSegments = _resolutionSegments;
-    unsigned int longitudeSegments = _resolutionSegments;
-
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> texCoords;
-    std::vector<unsigned int> indices;
-
-    for (unsigned int i = 0; i <= latitudeSegments; ++i)
+    // All bodies share one unit sphere per resolution and scale it when drawing.
+    _lodMeshes.clear();
+    if (Config::proceduralMeshes)
     {
-        float v = (float)i / latitudeSegments;
-        float latitudeAngle = glm::radians(-90.0f + v * 180.0f);
-        for (unsigned int j = 0; j <= longitudeSegments; ++j)
-        {
-            float u = (float)j / longitudeSegments;
-            float longitudeAngle = glm::radians(u * 360.0f);
-            float x = _radius * cos(latitudeAngle) * cos(longitudeAngle);
-            float y = _radius * sin(latitudeAngle);
-            float z = _radius * cos(latitudeAngle) * sin(longitudeAngle);
-            positions.push_back(glm::vec3(x, y, z));
-            normals.push_back(glm::normalize(glm::vec3(x, y, z)));
-            texCoords.push_back(glm::vec2(u, 1.0f - v));
-        }
+        // The vertex shader generates the sphere, so no resolution needs a mesh.
+        _sphere.reset();
+        createProceduralMesh();
     }
-    for (unsigned int i = 0; i < latitudeSegments; ++i)
+    else if (Config::sphereLod)
     {
-        for (unsigned int j = 0; j < longitudeSegments; ++j)
-        {
-            unsigned int v1 = (i * (longitudeSegments + 1)) + j;
-            unsigned int v2 = v1 + 1;
-            unsigned int v3 = ((i + 1) * (longitudeSegments + 1)) + j;
-            unsigned int v4 = v3 + 1;
-            indices.push_back(v1);
-            indices.push_back(v3);
-            indices.push_back(v2);
-            indices.push_back(v2);
-            indices.push_back(v3);
-            indices.push_back(v4);
-        }
+        // The resolution only caps the levels, so changing it builds no new meshes.
+        for (unsigned int level = 0; level <= SphereMesh::lodCap(_resolutionSegments); ++level)
+            _lodMeshes.push_back(SphereMesh::get(SphereMesh::lodSegments(level)));
+        _sphere = _lodMeshes.back();
     }
+    else
+    {
+        _sphere = SphereMesh::get(_resolutionSegments);
+    }
+}
 
-    _indexCount = static_cast<unsigned int>(indices.size());
-
-    if(_vertexArrayObject == 0)
-        glGenVertexArrays(1, &_vertexArrayObject);
-    glBindVertexArray(_vertexArrayObject);
-
-    if (_positionBuffer == 0)
-        glGenBuffers(1, &_positionBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, _positionBuffer);
-    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
-
-    if (_normalBuffer == 0)
-        glGenBuffers(1, &_normalBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, _normalBuffer);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(1);
-
-    if (_texCoordBuffer == 0)
-        glGenBuffers(1, &_texCoordBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, _texCoordBuffer);
-    glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), texCoords.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(2);
-
-    if (_indexBuffer == 0)
-        glGenBuffers(1, &_indexBuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+unsigned int Planet::proceduralSegments() const
+{
+    if (!Config::sphereLod)
+        return _resolutionSegments;
+    return SphereMesh::lodSegments(std::min(_lod, SphereMesh::lodCap(_resolutionSegments)));
+}
 
-    glBindVertexArray(0);
-    VERIFY(CG::checkError());
+GLuint Planet::loadTexture(std::string path)
+{
+    TextureSampler sampler;
+    sampler.wrapS = GL_REPEAT;
+    return TextureCache::instance().acquire(path, sampler);
 }
 
 std::string Planet::getVertexShader() const
 {
-    return Drawable::loadShaderFile(":/shader/phong.vs.glsl");
+    std::string source = Drawable::loadShaderFile(":/shader/phong.vs.glsl");
+    return Config::proceduralMeshes ? proceduralVertexShader(source) : source;
 }
 
 std::string Planet::getFragmentShader() const
@@ -386,71 +430,154 @@ std::string Planet::getFragmentShader() const
     return Drawable::loadShaderFile(":/shader/phong.fs.glsl");
 }
 
+std::string Planet::getShaderDefines() const
+{
+    return Config::proceduralMeshes ? "#define PROCEDURAL_SPHERE 1\n" : "";
+}
+
 Planet::~Planet(){
+    releaseTexture(_textureID);
+    releaseTexture(_cloudTextureID);
 }
 
-void Planet::calculatePath(glm::mat4 modelViewMatrix)
-{
-    qDebug() << "Planet::calculatePath() called for:" << QString::fromStdString(_name);
-    for(auto child : _children){
-        unsigned int longestCommonMultiple = child->getCommonYears(_daysPerYear);
-        for(unsigned int i = 0; i <= longestCommonMultiple; i++){
-            float elapsedSimulatedDays = 1.0f;
-            child->updatePath(elapsedSimulatedDays, modelViewMatrix);
+namespace {
+    unsigned long long greatestCommonDivisor(unsigned long long a, unsigned long long b)
+    {
+        while (b != 0)
+        {
+            unsigned long long t = a % b;
+            a = b;
+            b = t;
         }
+        return a;
     }
-     createPath();
-}
 
+    struct PathSegment
+    {
+        float t0, t1;
+        glm::vec3 p0, p1, pm;
+        float error;
+
+        bool operator<(const PathSegment& other) const
+        {
+            if (error != other.error)
+                return error < other.error;
+            return t0 > other.t0;
+        }
+    };
+
+    // Samples 'position' over [0, period] with at most 'budget' points. Starts
+    // from a uniform grid and then keeps splitting the segment whose midpoint
+    // deviates most from its chord, i.e. where the curve bends the most.
+    template<typename F>
+    std::vector<glm::vec3> samplePath(F position, float period, unsigned int budget, float tolerance)
+    {
+        budget = std::max(budget, 3u);
+        unsigned int initialSegments = std::max(2u, budget / 4);
+
+        std::vector<std::pair<float, glm::vec3>> samples;
+        samples.reserve(budget);
+
+        std::priority_queue<PathSegment> segments;
+        auto makeSegment = [&](float t0, float t1, glm::vec3 p0, glm::vec3 p1) {
+            glm::vec3 pm = position(0.5f * (t0 + t1));
+            float error = glm::length(pm - 0.5f * (p0 + p1));
+            segments.push(PathSegment{t0, t1, p0, p1, pm, error});
+        };
+
+        float t0 = 0.0f;
+        glm::vec3 p0 = position(t0);
+        samples.emplace_back(t0, p0);
+        for (unsigned int i = 1; i <= initialSegments; ++i)
+        {
+            float t1 = period * i / initialSegments;
+            glm::vec3 p1 = position(t1);
+            samples.emplace_back(t1, p1);
+            makeSegment(t0, t1, p0, p1);
+            t0 = t1;
+            p0 = p1;
+        }
+
+        while (samples.size() < budget && !segments.empty() && segments.top().error > tolerance)
+        {
+            PathSegment s = segments.top();
+            segments.pop();
+            float tm = 0.5f * (s.t0 + s.t1);
+            samples.emplace_back(tm, s.pm);
+            makeSegment(s.t0, tm, s.p0, s.pm);
+            makeSegment(tm, s.t1, s.pm, s.p1);
+        }
+
+        std::sort(samples.begin(), samples.end(),
+                  [](const std::pair<float, glm::vec3>& a, const std::pair<float, glm::vec3>& b) { return a.first < b.first; });
 
-unsigned int Planet::getCommonYears(unsigned int other)
+        std::vector<glm::vec3> positions;
+        positions.reserve(samples.size());
+        for (const auto& sample : samples)
+            positions.push_back(sample.second);
+        return positions;
+    }
+}
+
+void Planet::calculatePath(glm::mat4 modelViewMatrix)
 {
-    unsigned int tmp = other * _daysPerYear / greatestCommonDivisor(other, _daysPerYear);
-    unsigned int result = tmp;
+    qDebug() << "Planet::calculatePath() called for:" << QString::fromStdString(_name);
+    std::vector<const Planet*> chain;
     for(auto child : _children){
-        result = std::max(result, child->getCommonYears(tmp));
+        child->generatePath(chain, modelViewMatrix);
     }
-    return result;
+    createPath();
 }
 
-unsigned int Planet::greatestCommonDivisor(unsigned int a, unsigned int b)
+glm::mat4 Planet::pathTransform(float days) const
 {
-    if (b == 0)
-        return a;
-    else
-        return greatestCommonDivisor(b, a % b);
+    // The spin is sampled at whole days, like the path always was, so only
+    // the residual turn per day shows up in the curve.
+    float spinPerDay = std::fmod(_localRotationSpeed, 360.0f);
+
+    float globalRotation = _globalRotation + days * _globalRotationSpeed;
+    float localRotation = _localRotation + days * spinPerDay;
+
+    glm::mat4 m = glm::rotate(glm::radians(_inclination), glm::vec3(0.0f, 0.0f, 1.0f));
+    m = glm::rotate(m, glm::radians(globalRotation), glm::vec3(0,1,0));
+    m = glm::translate(m, glm::vec3(_distance, 0, 0));
+    m = glm::rotate(m, glm::radians(localRotation), glm::vec3(0,1,0));
+    return m;
 }
 
-void Planet::updatePath(float elapsedSimulatedDays, glm::mat4 modelViewMatrix)
+void Planet::generatePath(std::vector<const Planet*>& chain, const glm::mat4& modelViewMatrix)
 {
-    glm::mat4 orbitBaseMatrix = glm::rotate(modelViewMatrix, glm::radians(_inclination), glm::vec3(0.0f, 0.0f, 1.0f));
-
-    _globalRotation += elapsedSimulatedDays * _globalRotationSpeed;
-    while(_globalRotation >= 360.f) _globalRotation -= 360.0f;
-    while(_globalRotation < 0.0f) _globalRotation += 360.0f;
-
-    _localRotation += elapsedSimulatedDays * _localRotationSpeed;
-    while(_localRotation >= 360.f) _localRotation -= 360.0f;
-    while(_localRotation < 0.0f) _localRotation += 360.0f;
+    chain.push_back(this);
 
-    std::stack<glm::mat4> modelview_stack;
-    modelview_stack.push(orbitBaseMatrix);
-        modelview_stack.top() = glm::rotate(modelview_stack.top(), glm::radians(_globalRotation), glm::vec3(0,1,0));
-        modelview_stack.top() = glm::translate(modelview_stack.top(), glm::vec3(_distance, 0, 0));
-        modelview_stack.top() = glm::rotate(modelview_stack.top(), glm::radians(_localRotation), glm::vec3(0,1,0));
-        _modelViewMatrix = glm::mat4(modelview_stack.top());
-    modelview_stack.pop();
+    // The curve closes after the common multiple of all years along the chain.
+    unsigned long long period = 1;
+    for (const Planet* p : chain)
+    {
+        if (p->_daysPerYear == 0)
+            continue;
+        period = period / greatestCommonDivisor(period, p->_daysPerYear) * p->_daysPerYear;
+        if (period >= Config::pathMaxDays)
+        {
+            period = Config::pathMaxDays;
+            break;
+        }
+    }
 
-    addPathPoint();
+    auto position = [&](float days) {
+        glm::mat4 m = modelViewMatrix;
+        for (const Planet* p : chain)
+            m = m * p->pathTransform(days);
+        return glm::vec3(m * glm::vec4(0,0,0,1));
+    };
+    _path->setPositions(samplePath(position, static_cast<float>(period),
+                                   Config::pathPointBudget, Config::pathTolerance));
 
     for (const auto& child : _children)
     {
-        child->updatePath(elapsedSimulatedDays, _modelViewMatrix);
+        child->generatePath(chain, modelViewMatrix);
     }
-}
 
-void Planet::addPathPoint(){
-    _path->addPosition(glm::vec3(_modelViewMatrix * glm::vec4(0,0,0,1)));
+    chain.pop_back();
 }
 
 void Planet::createPath(){
@@ -11,9 +11,14 @@ class Path;
 class Sun;
 class Cone;
 class Ring;
+class BodyBatch;
+class SphereMesh;
+class MeshRebuilder;
 
 class Planet : public Drawable
 {
+    friend class FlatHierarchy;
+
 public:
     Planet(std::string name = "UNNAMED PLANET",
             float radius = 1.0f,
@@ -36,10 +41,25 @@ public:
 
     virtual void setResolution(unsigned int segments) override;
 
+    // Queues the orbits, rings and cones of the subtree for rebuilding at a resolution.
+    virtual void requestResolution(unsigned int segments, MeshRebuilder& rebuilder);
+
+    // Switches the bodies of the subtree to the sphere meshes of a resolution; see SphereMesh::get().
+    virtual void applySphereResolution(unsigned int segments);
+
     virtual void setCloudTexture(std::string textureLocation);
 
     virtual void setRing(std::shared_ptr<Ring> ring);
 
+    virtual void setBodyBatch(std::shared_ptr<BodyBatch> batch);
+
+    // Whether draw() may hand the body to the shared BodyBatch.
+    virtual bool isInstanceable() const;
+
+    // Radius around the body's center that holds the body and everything
+    // attached to it, without the children; used for culling.
+    virtual float boundingRadius() const;
+
     ~Planet();
 
 protected:
@@ -59,10 +79,13 @@ protected:
 
     float _totalTimeMs = 0.0f;
 
-    unsigned int _indexCount = 0;
+    std::shared_ptr<SphereMesh> _sphere;
+    std::vector<std::shared_ptr<SphereMesh>> _lodMeshes; /**< Levels up to the resolution, with Config::sphereLod */
+    std::shared_ptr<BodyBatch> _bodyBatch;
 
     std::string _textureLocation;
     GLuint _textureID = 0;
+    int _textureLayer = -1;
 
     std::string _cloudTextureLocation;
     GLuint _cloudTextureID = 0;
@@ -75,15 +98,39 @@ protected:
     std::shared_ptr<Sun> _sun;
     std::shared_ptr<Cone> _laser;
 
+    // Written by FlatHierarchy::cull() before drawing; all true without culling.
+    bool _subtreeVisible = true;
+    bool _bodyVisible = true;
+    bool _orbitVisible = true;
+    bool _pathVisible = true;
+    unsigned int _lod = ~0u;                   /**< Level of detail from the projected size, clamped to _lodMeshes */
+    bool _impostor = false;                    /**< Small enough on screen to be ray-cast, see ImpostorBatch */
+
     virtual void createObject() override;
     virtual std::string getVertexShader() const override;
     virtual std::string getFragmentShader() const override;
+    virtual std::string getShaderDefines() const override;
+
+    // Repeats in s, so the texture coordinates past 1 at the seam of the icosphere and cube sphere wrap around.
+    virtual GLuint loadTexture(std::string path) override;
+
+    // Segments of the sphere generated in the vertex shader with Config::proceduralMeshes:
+    // the level of detail capped by the resolution, or the resolution.
+    unsigned int proceduralSegments() const;
+
+    // Queues one drawable for MeshRebuilder; it keeps the drawable alive until the rebuild is applied.
+    static void requestMesh(MeshRebuilder& rebuilder, const std::shared_ptr<Drawable>& drawable, unsigned int segments);
+
+    // Transformation relative to the parent after 'days' further simulated days,
+    // evaluated in closed form from the orbital parameters.
+    glm::mat4 pathTransform(float days) const;
 
-    unsigned int getCommonYears(unsigned int other);
-    unsigned int greatestCommonDivisor(unsigned int a, unsigned int b);
+    // Updates everything attached to the body once its matrices are known;
+    // used by FlatHierarchy instead of the recursive update().
+    virtual void updateAttachments(float elapsedTimeMs, const glm::mat4& parentMatrix,
+                                   const glm::mat4& orbitMatrix, const glm::mat4& anchorMatrix);
 
-    virtual void updatePath(float elapsedSimulatedDays, glm::mat4 modelViewMatrix);
-    virtual void addPathPoint();
+    virtual void generatePath(std::vector<const Planet*>& chain, const glm::mat4& modelViewMatrix);
     virtual void createPath();
 };
 
@@ -0,0 +1,329 @@
+#include "planets/programcache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QDebug>
+
+namespace {
+    // Header of the binary files; the program binary follows it.
+    struct BinaryHeader
+    {
+        char magic[4];
+        uint32_t version;
+        char driverHash[20];        // SHA-1 of ProgramCache::_driver
+        uint32_t binaryFormat;
+        uint32_t binaryLength;
+    };
+
+    const char s_binaryMagic[4] = { 'T', 'B', 'P', 'B' };
+    const uint32_t s_binaryVersion = 1;
+
+    QByteArray sha1(const std::string& data)
+    {
+        return QCryptographicHash::hash(QByteArray(data.data(), static_cast<int>(data.size())), QCryptographicHash::Sha1);
+    }
+
+    // Defines have to follow the #version line, which must come first.
+    std::string insertDefines(const std::string& source, const std::string& defines)
+    {
+        if (defines.empty())
+            return source;
+        size_t version = source.find("#version");
+        if (version == std::string::npos)
+            return defines + source;
+        size_t lineEnd = source.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return source + "\n" + defines;
+        return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+    }
+
+    GLuint compileShader(GLenum type, const std::string& source, const std::string& name)
+    {
+        const char* data = source.c_str();
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &data, NULL);
+        glCompileShader(shader);
+
+        GLint status;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (status == GL_FALSE) {
+            GLint logLen;
+            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLen);
+            std::vector<char> log(std::max(logLen, 1));
+            glGetShaderInfoLog(shader, logLen, NULL, log.data());
+            qDebug() << (type == GL_VERTEX_SHADER ? "Vertex" : "Fragment") << "Shader Compile Error ("
+                     << QString::fromStdString(name) << "): " << log.data();
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+}
+
+ProgramCache& ProgramCache::instance()
+{
+    static ProgramCache cache;
+    return cache;
+}
+
+GLuint ProgramCache::acquire(const std::string& vertexSource, const std::string& fragmentSource,
+                             const std::string& defines, const std::string& name)
+{
+    Key key(vertexSource, fragmentSource, defines);
+    auto it = _entries.find(key);
+    if (it != _entries.end())
+    {
+        ++_hits;
+        ++it->second.references;
+        return it->second.program;
+    }
+
+    ++_misses;
+
+    QElapsedTimer timer;
+    timer.start();
+    GLuint program = 0;
+    std::string path;
+    if (diskCacheEnabled())
+    {
+        path = binaryPath(vertexSource, fragmentSource, defines);
+        program = loadBinary(path);
+        if (program != 0)
+        {
+            ++_diskHits;
+            _diskMilliseconds += timer.nsecsElapsed() / 1.0e6;
+        }
+    }
+
+    if (program == 0)
+    {
+        timer.restart();
+        program = build(insertDefines(vertexSource, defines), insertDefines(fragmentSource, defines), name);
+        _buildMilliseconds += timer.nsecsElapsed() / 1.0e6;
+
+        // Failed builds are not cached, so fixed sources are picked up by the next acquire().
+        if (program == 0)
+            return 0;
+
+        if (!path.empty())
+            saveBinary(path, program);
+    }
+
+    it = _entries.emplace(key, Entry{program, 1}).first;
+    _keys.emplace(program, &it->first);
+    return program;
+}
+
+GLuint ProgramCache::build(const std::string& vertexSource, const std::string& fragmentSource, const std::string& name) const
+{
+    GLuint vs = compileShader(GL_VERTEX_SHADER, vertexSource, name);
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragmentSource, name);
+    if (vs == 0 || fs == 0)
+    {
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    if (_diskSupport == 1)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+
+    // The linked program does not need the shader objects any more.
+    glDetachShader(program, vs);
+    glDetachShader(program, fs);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint linkStatus;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if (linkStatus == GL_FALSE) {
+        GLint logLen;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLen);
+        std::vector<char> log(std::max(logLen, 1));
+        glGetProgramInfoLog(program, logLen, NULL, log.data());
+        qDebug() << "Shader Program Link Error (" << QString::fromStdString(name) << "): " << log.data();
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void ProgramCache::setDiskDirectory(const std::string& directory)
+{
+    _diskDirectory = directory;
+    if (!_diskDirectory.empty() && !QDir().mkpath(QString::fromStdString(_diskDirectory)))
+    {
+        qDebug() << "Cannot create program cache directory" << QString::fromStdString(_diskDirectory);
+        _diskDirectory.clear();
+    }
+}
+
+bool ProgramCache::diskCacheEnabled()
+{
+    if (_diskDirectory.empty())
+        return false;
+
+    if (_diskSupport < 0)
+    {
+        // GL 4.0 has no program binaries in core; a driver without binary formats cannot store any.
+        GLint formats = 0;
+        if (GLEW_ARB_get_program_binary)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        _diskSupport = (formats > 0 ? 1 : 0);
+        if (_diskSupport == 0)
+            qDebug() << "ProgramCache: the driver cannot store program binaries, disk cache disabled.";
+
+        _driver = std::string(reinterpret_cast<const char*>(glGetString(GL_VENDOR))) + "\n"
+                + reinterpret_cast<const char*>(glGetString(GL_RENDERER)) + "\n"
+                + reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    }
+    return _diskSupport == 1;
+}
+
+std::string ProgramCache::binaryPath(const std::string& vertexSource, const std::string& fragmentSource,
+                                     const std::string& defines) const
+{
+    // The driver is not part of the name, so a driver update replaces the old files instead of piling up new ones.
+    std::string key = vertexSource + '\0' + fragmentSource + '\0' + defines;
+    QString name = QString::fromLatin1(sha1(key).toHex()) + ".bin";
+    return QDir(QString::fromStdString(_diskDirectory)).filePath(name).toStdString();
+}
+
+GLuint ProgramCache::loadBinary(const std::string& path) const
+{
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QFile::ReadOnly))
+        return 0;
+    QByteArray data = file.readAll();
+
+    BinaryHeader header;
+    if (data.size() < static_cast<int>(sizeof(header)))
+        return 0;
+    std::memcpy(&header, data.constData(), sizeof(header));
+    QByteArray driverHash = sha1(_driver);
+    if (std::memcmp(header.magic, s_binaryMagic, 4) != 0 || header.version != s_binaryVersion
+            || std::memcmp(header.driverHash, driverHash.constData(), sizeof(header.driverHash)) != 0
+            || header.binaryLength != data.size() - static_cast<int>(sizeof(header)))
+    {
+        qDebug() << "ProgramCache: stale program binary" << QString::fromStdString(path);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, data.constData() + sizeof(header), header.binaryLength);
+
+    GLint linkStatus;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if (linkStatus == GL_FALSE)
+    {
+        // Drivers may reject their own binaries, e.g. after a configuration change.
+        qDebug() << "ProgramCache: program binary rejected by the driver" << QString::fromStdString(path);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void ProgramCache::saveBinary(const std::string& path, GLuint program) const
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    BinaryHeader header;
+    std::memcpy(header.magic, s_binaryMagic, 4);
+    header.version = s_binaryVersion;
+    std::memcpy(header.driverHash, sha1(_driver).constData(), sizeof(header.driverHash));
+    header.binaryLength = static_cast<uint32_t>(length);
+
+    std::vector<char> data(sizeof(header) + length);
+    GLenum format;
+    glGetProgramBinary(program, length, NULL, &format, data.data() + sizeof(header));
+    header.binaryFormat = format;
+    std::memcpy(data.data(), &header, sizeof(header));
+
+    // QSaveFile renames on commit, so an interrupted write never leaves a truncated binary behind.
+    QSaveFile file(QString::fromStdString(path));
+    if (!file.open(QFile::WriteOnly) || file.write(data.data(), data.size()) != static_cast<qint64>(data.size())
+            || !file.commit())
+        qDebug() << "ProgramCache: cannot write program binary" << QString::fromStdString(path);
+}
+
+void ProgramCache::release(GLuint program)
+{
+    if (program == 0)
+        return;
+
+    auto it = _keys.find(program);
+    if (it == _keys.end())
+    {
+        qDebug() << "ProgramCache::release() called for unknown program" << program;
+        return;
+    }
+
+    Entry& entry = _entries.find(*it->second)->second;
+    if (entry.references > 0)
+        --entry.references;
+}
+
+unsigned int ProgramCache::evictUnused()
+{
+    unsigned int evicted = 0;
+    for (auto it = _entries.begin(); it != _entries.end();)
+    {
+        if (it->second.references == 0)
+        {
+            glDeleteProgram(it->second.program);
+            _keys.erase(it->second.program);
+            it = _entries.erase(it);
+            ++evicted;
+        }
+        else
+            ++it;
+    }
+    return evicted;
+}
+
+unsigned int ProgramCache::hits() const
+{
+    return _hits;
+}
+
+unsigned int ProgramCache::misses() const
+{
+    return _misses;
+}
+
+double ProgramCache::buildMilliseconds() const
+{
+    return _buildMilliseconds;
+}
+
+unsigned int ProgramCache::diskHits() const
+{
+    return _diskHits;
+}
+
+double ProgramCache::diskMilliseconds() const
+{
+    return _diskMilliseconds;
+}
+
+void ProgramCache::logStatistics() const
+{
+    qDebug() << "ProgramCache:" << _entries.size() << "programs," << _hits << "hits,"
+             << _misses << "misses (" << _diskHits << "from disk)," << _buildMilliseconds
+             << "ms compiling and linking," << _diskMilliseconds << "ms loading binaries.";
+}
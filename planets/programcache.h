@@ -0,0 +1,115 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+#include <GL/glew.h>
+
+/**
+ * @brief The ProgramCache class shares linked shader programs across the process
+ *
+ * Programs are keyed by vertex source, fragment source and defines, so all
+ * drawables with the same shaders use one program. acquire() compiles and
+ * links on the first request and only adds a reference afterwards; the
+ * shader objects are deleted right after linking. release() drops a
+ * reference again. Unreferenced programs stay resident until evictUnused()
+ * deletes them. All functions except release() need the GL context the
+ * programs belong to.
+ *
+ * With a disk directory set and ARB_get_program_binary available, linked
+ * programs are also stored as driver binaries, so later runs skip GLSL
+ * compilation. A binary is only used if it was written for the same sources
+ * and by the same driver (vendor, renderer and version string); otherwise,
+ * or if the driver rejects it, the program is rebuilt and the file replaced.
+ */
+class ProgramCache
+{
+public:
+    /**
+     * @brief instance Returns the process-wide cache
+     */
+    static ProgramCache& instance();
+
+    /**
+     * @brief acquire Returns the program for the given sources, building it if needed
+     * @param vertexSource the vertex shader source
+     * @param fragmentSource the fragment shader source
+     * @param defines lines like "#define CLOUDS 1\n", inserted after the #version line of both shaders
+     * @param name a name for error messages
+     * @return the program, or 0 if it could not be compiled or linked
+     */
+    GLuint acquire(const std::string& vertexSource, const std::string& fragmentSource,
+                   const std::string& defines = "", const std::string& name = "");
+
+    /**
+     * @brief setDiskDirectory Enables the on-disk binary cache
+     * @param directory where program binaries are stored; empty disables the disk cache
+     */
+    void setDiskDirectory(const std::string& directory);
+
+    /**
+     * @brief release Drops one reference to a program from acquire()
+     * @param program the program; 0 is ignored
+     */
+    void release(GLuint program);
+
+    /**
+     * @brief evictUnused Deletes all programs without references
+     * @return the number of deleted programs
+     */
+    unsigned int evictUnused();
+
+    unsigned int hits() const;
+    unsigned int misses() const;
+    double buildMilliseconds() const;
+    unsigned int diskHits() const;
+    double diskMilliseconds() const;
+
+    /**
+     * @brief logStatistics Prints the counters with qDebug()
+     */
+    void logStatistics() const;
+
+private:
+    ProgramCache() = default;
+    ProgramCache(const ProgramCache&) = delete;
+    ProgramCache& operator=(const ProgramCache&) = delete;
+
+    GLuint build(const std::string& vertexSource, const std::string& fragmentSource, const std::string& name) const;
+
+    bool diskCacheEnabled();
+    std::string binaryPath(const std::string& vertexSource, const std::string& fragmentSource,
+                           const std::string& defines) const;
+    GLuint loadBinary(const std::string& path) const;
+    void saveBinary(const std::string& path, GLuint program) const;
+
+    typedef std::tuple<std::string, std::string, std::string> Key;
+
+    struct Entry
+    {
+        GLuint program;
+        unsigned int references;
+    };
+
+    std::map<Key, Entry> _entries;
+    std::map<GLuint, const Key*> _keys;
+
+    unsigned int _hits = 0;
+    unsigned int _misses = 0;
+    double _buildMilliseconds = 0.0;
+
+    std::string _diskDirectory;
+    std::string _driver;            // vendor, renderer and version, queried on first use
+    int _diskSupport = -1;          // -1 until checked against the current context
+    unsigned int _diskHits = 0;
+    double _diskMilliseconds = 0.0;
+};
+
+#endif // PROGRAMCACHE_H
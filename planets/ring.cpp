@@ -11,6 +11,7 @@
 
 #include "glbase/gltool.hpp"
 #include "gui/config.h"
+#include "planets/meshdata.h"
 #include "planets/sun.h"
 
 #include <QDebug>
@@ -25,8 +26,7 @@ Ring::Ring(std::string name,
       _outerRadius(outerRadius),
       _axialTilt(axialTilt),
       _textureLocation(textureLocation),
-      _textureID(0),
-      _indexCount(0)
+      _textureID(0)
 {
     qDebug() << "Ring constructor called for:" << QString::fromStdString(_name);
 }
@@ -36,6 +36,7 @@ void Ring::init()
     qDebug() << "Ring::init() called for:" << QString::fromStdString(_name);
     Drawable::init();
 
+    releaseTexture(_textureID);
     if (!_textureLocation.empty())
     {
         _textureID = loadTexture(_textureLocation);
@@ -46,6 +47,16 @@ void Ring::init()
     }
 }
 
+Ring::~Ring()
+{
+    releaseTexture(_textureID);
+}
+
+float Ring::outerRadius() const
+{
+    return _outerRadius;
+}
+
 void Ring::update(float elapsedTimeMs, glm::mat4 modelViewMatrix)
 {
     _modelViewMatrix = glm::rotate(modelViewMatrix, glm::radians(_axialTilt), glm::vec3(1.0f, 0.0f, 0.0f));
@@ -64,24 +75,23 @@ void Ring::draw(glm::mat4 projection_matrix) const
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, _textureID);
-    glUniform1i(glGetUniformLocation(_program, "uTextureSampler"), 0);
 
-    glm::vec3 lightPosView = glm::vec3(0.0f, 0.0f, 0.0f);
-    glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+    setLightUniforms(_sun, nullptr);
+
+    glUniformMatrix4fv(uniform(U_PROJECTION_MATRIX), 1, GL_FALSE, glm::value_ptr(projection_matrix));
+    glUniformMatrix4fv(uniform(U_MODELVIEW_MATRIX), 1, GL_FALSE, glm::value_ptr(_modelViewMatrix));
 
-    if (Config::sunLight && _sun)
+    if (Config::proceduralMeshes)
     {
-        lightPosView = _sun->getPosition();
-        lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+        glUniform1i(uniform(U_SEGMENTS), _resolutionSegments);
+        glUniform1f(uniform(U_INNER_RADIUS), _innerRadius);
+        glUniform1f(uniform(U_OUTER_RADIUS), _outerRadius);
+        glDrawArrays(GL_TRIANGLES, 0, 6 * _resolutionSegments);
+    }
+    else
+    {
+        glDrawElements(GL_TRIANGLES, _indexCount, _indexType, 0);
     }
-
-    glUniform3fv(glGetUniformLocation(_program, "uLightPosView"), 1, glm::value_ptr(lightPosView));
-    glUniform3fv(glGetUniformLocation(_program, "uLightColor"), 1, glm::value_ptr(lightColor));
-
-    glUniformMatrix4fv(glGetUniformLocation(_program, "projection_matrix"), 1, GL_FALSE, glm::value_ptr(projection_matrix));
-    glUniformMatrix4fv(glGetUniformLocation(_program, "modelview_matrix"), 1, GL_FALSE, glm::value_ptr(_modelViewMatrix));
-
-    glDrawElements(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, 0);
 
     glBindVertexArray(0);
     glActiveTexture(GL_TEXTURE0);
@@ -90,82 +100,56 @@ void Ring::draw(glm::mat4 projection_matrix) const
     VERIFY(CG::checkError());
 }
 
-void Ring::createObject()
+std::function<void(MeshData&)> Ring::meshBuilder(unsigned int segments) const
 {
-    qDebug() << "Ring::createObject() called for:" << QString::fromStdString(_name);
-    unsigned int segments = _resolutionSegments;
-
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> texCoords;
-    std::vector<unsigned int> indices;
-
-    for (unsigned int i = 0; i <= segments; ++i)
-    {
-        float u = (float)i / segments;
-        float angle = u * glm::radians(360.0f);
-        float cosA = cos(angle);
-        float sinA = sin(angle);
-
-        positions.push_back(glm::vec3(_innerRadius * cosA, 0.0f, _innerRadius * sinA));
-        normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
-        texCoords.push_back(glm::vec2(0.0f, u));
-
-        positions.push_back(glm::vec3(_outerRadius * cosA, 0.0f, _outerRadius * sinA));
-        normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
-        texCoords.push_back(glm::vec2(1.0f, u));
-    }
-
-    for (unsigned int i = 0; i < segments; ++i)
-    {
-        unsigned int v1 = i * 2;
-        unsigned int v2 = v1 + 1;
-        unsigned int v3 = (i + 1) * 2;
-        unsigned int v4 = v3 + 1;
-
-        indices.push_back(v1);
-        indices.push_back(v3);
-        indices.push_back(v2);
-
-        indices.push_back(v2);
-        indices.push_back(v3);
-        indices.push_back(v4);
-    }
-
-    _indexCount = static_cast<unsigned int>(indices.size());
-
-    if (_vertexArrayObject == 0)
-        glGenVertexArrays(1, &_vertexArrayObject);
-    glBindVertexArray(_vertexArrayObject);
+    if (Config::proceduralMeshes)
+        return nullptr;
+
+    float innerRadius = _innerRadius;
+    float outerRadius = _outerRadius;
+    return [innerRadius, outerRadius, segments](MeshData& mesh) {
+        mesh.reserve(2 * (segments + 1), 6 * segments);
+        for (unsigned int i = 0; i <= segments; ++i)
+        {
+            float u = (float)i / segments;
+            float angle = u * glm::radians(360.0f);
+            float cosA = cos(angle);
+            float sinA = sin(angle);
+
+            mesh.positions.push_back(glm::vec3(innerRadius * cosA, 0.0f, innerRadius * sinA));
+            mesh.normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+            mesh.texCoords.push_back(glm::vec2(0.0f, u));
+
+            mesh.positions.push_back(glm::vec3(outerRadius * cosA, 0.0f, outerRadius * sinA));
+            mesh.normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+            mesh.texCoords.push_back(glm::vec2(1.0f, u));
+        }
 
-    if (_positionBuffer == 0)
-        glGenBuffers(1, &_positionBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, _positionBuffer);
-    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
-
-    if (_normalBuffer == 0)
-        glGenBuffers(1, &_normalBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, _normalBuffer);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(1);
-
-    if (_texCoordBuffer == 0)
-        glGenBuffers(1, &_texCoordBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, _texCoordBuffer);
-    glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), texCoords.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(2);
-
-    if (_indexBuffer == 0)
-        glGenBuffers(1, &_indexBuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        for (unsigned int i = 0; i < segments; ++i)
+        {
+            unsigned int v1 = i * 2;
+            unsigned int v2 = v1 + 1;
+            unsigned int v3 = (i + 1) * 2;
+            unsigned int v4 = v3 + 1;
+
+            mesh.indices.push_back(v1);
+            mesh.indices.push_back(v3);
+            mesh.indices.push_back(v2);
+
+            mesh.indices.push_back(v2);
+            mesh.indices.push_back(v3);
+            mesh.indices.push_back(v4);
+        }
+    };
+}
 
-    glBindVertexArray(0);
-    VERIFY(CG::checkError());
+void Ring::createObject()
+{
+    qDebug() << "Ring::createObject() called for:" << QString::fromStdString(_name);
+    if (Config::proceduralMeshes)
+        createProceduralMesh();
+    else
+        createMesh();
 }
 
 void Ring::setLights(std::shared_ptr<Sun> sun, std::shared_ptr<Cone> laser)
@@ -177,10 +161,16 @@ void Ring::setLights(std::shared_ptr<Sun> sun, std::shared_ptr<Cone> laser)
 
 std::string Ring::getVertexShader() const
 {
-    return Drawable::loadShaderFile(":/shader/phong.vs.glsl");
+    std::string source = Drawable::loadShaderFile(":/shader/phong.vs.glsl");
+    return Config::proceduralMeshes ? proceduralVertexShader(source) : source;
 }
 
 std::string Ring::getFragmentShader() const
 {
     return Drawable::loadShaderFile(":/shader/ring.fs.glsl");
+}
+
+std::string Ring::getShaderDefines() const
+{
+    return Config::proceduralMeshes ? "#define PROCEDURAL_ANNULUS 1\n" : "";
 }
\ No newline at end of file
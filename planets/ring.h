@@ -17,16 +17,23 @@ public:
          std::string textureLocation,
          float axialTilt);
 
+    ~Ring();
+
     virtual void init() override;
     virtual void draw(glm::mat4 projection_matrix) const override;
     virtual void update(float elapsedTimeMs, glm::mat4 modelViewMatrix) override;
 
+    virtual std::function<void(MeshData&)> meshBuilder(unsigned int segments) const override;
+
     virtual void setLights(std::shared_ptr<Sun> sun, std::shared_ptr<Cone> laser);
 
+    float outerRadius() const;
+
 protected:
     virtual void createObject() override;
     virtual std::string getVertexShader() const override;
     virtual std::string getFragmentShader() const override;
+    virtual std::string getShaderDefines() const override;
 
     float _innerRadius;
     float _outerRadius;
@@ -35,8 +42,6 @@ protected:
     std::string _textureLocation;
     GLuint _textureID = 0;
 
-    unsigned int _indexCount = 0;
-
     std::shared_ptr<Sun> _sun;
     std::shared_ptr<Cone> _laser;
 };
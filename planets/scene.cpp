@@ -0,0 +1,533 @@
+#include "planets/scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <random>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStandardPaths>
+#include <QDebug>
+
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "glbase/sceneload.hpp"
+#include "gui/config.h"
+
+#include "planets/assetbundle.h"
+#include "planets/bodybatch.h"
+#include "planets/coordinatesystem.h"
+#include "planets/deathstar.h"
+#include "planets/meshdata.h"
+#include "planets/meshrebuilder.h"
+#include "planets/planet.h"
+#include "planets/programcache.h"
+#include "planets/ring.h"
+#include "planets/skybox.h"
+#include "planets/spheremesh.h"
+#include "planets/simulation.h"
+#include "planets/sun.h"
+#include "planets/texturecache.h"
+#include "planets/textureloader.h"
+
+namespace {
+    const char* s_bodyTextures[] = {
+        ":/res/images/mercury.bmp",
+        ":/res/images/venus.bmp",
+        ":/res/images/mars.bmp",
+        ":/res/images/jupiter.bmp",
+        ":/res/images/saturn.bmp",
+        ":/res/images/uranus.bmp",
+        ":/res/images/neptune.bmp",
+        ":/res/images/pluto.bmp",
+        ":/res/images/moon.bmp"
+    };
+}
+
+SceneOptions SceneOptions::parse(const std::vector<std::string>& arguments)
+{
+    SceneOptions options;
+    for (size_t i = 0; i < arguments.size(); i++)
+    {
+        const std::string& arg = arguments[i];
+        if (arg == "--paths")
+        {
+            options.paths = true;
+            continue;
+        }
+        if (i + 1 >= arguments.size())
+            continue;
+        const char* value = arguments[i + 1].c_str();
+        if (arg == "--scene")
+            options.file = value;
+        else if (arg == "--seed")
+        {
+            options.seed = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+            options.seeded = true;
+        }
+        else if (arg == "--bodies")
+        {
+            options.bodies = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+            options.synthetic = true;
+        }
+        else if (arg == "--depth")
+            options.depth = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+        else if (arg == "--fanout")
+            options.fanOut = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+        else if (arg == "--rings")
+            options.ringFraction = std::strtof(value, nullptr);
+        else
+            continue;
+        i++;
+    }
+    options.bodies = std::max(options.bodies, 1u);
+    return options;
+}
+
+Scene::Scene()
+{
+    qDebug() << "Scene constructor called.";
+    _skybox = std::make_shared<Skybox>("Skybox");
+    _coordSystem = std::make_shared<CoordinateSystem>("Coordinate system");
+    _bodyBatch = std::make_shared<BodyBatch>("Body batch");
+    _rebuilder.reset(new MeshRebuilder());
+}
+
+Scene::~Scene()
+{
+    qDebug() << "Scene destructor called.";
+    _simulation.reset();
+    _rebuilder.reset();
+    _hierarchy.compile(nullptr);
+}
+
+void Scene::initResources()
+{
+    const char* bundle = ::getenv("COREGL_BUNDLE");
+    AssetBundle::instance().open(bundle ? bundle : (QCoreApplication::applicationDirPath() + "/assets.bundle").toStdString());
+    TextureLoader::instance().setMipDirectory((QCoreApplication::applicationDirPath() + "/images/mips").toStdString());
+    if (Config::programBinaries)
+    {
+        const char* programs = ::getenv("COREGL_PROGRAM_CACHE");
+        ProgramCache::instance().setDiskDirectory(programs ? programs
+            : (QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/programs").toStdString());
+    }
+}
+
+void Scene::releaseResources()
+{
+    TextureLoader::instance().releaseGL();
+    TextureCache::instance().evictUnused();
+    ProgramCache::instance().evictUnused();
+}
+
+void Scene::buildSolarSystem(unsigned int seed)
+{
+    qDebug() << "Scene::buildSolarSystem() called with seed:" << seed;
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> degrees(0, 359);
+    auto randAngle = [&]() { return static_cast<float>(degrees(random)); };
+
+    _root           = std::make_shared<Planet> ("Erde",     1.0,    0.0,    24.0,   1, ":/res/images/earth.bmp", 0.0f, 0.0f);
+    _root->setCloudTexture(":/res/images/clouds.bmp");
+    auto moon       = std::make_shared<Planet>("Mond",      0.215,  2.0,    27.3,   27, ":/res/images/moon.bmp", randAngle(), 5.1f);
+    auto sun        = std::make_shared<Sun>("Sonne",        1.2,    6.0,    50.0,   350, ":/res/images/sun.bmp", randAngle(), 7.25f);
+
+    auto mercury    = std::make_shared<Planet>("Merkur",    0.34,   2.32,   1407.5, 150, ":/res/images/mercury.bmp", randAngle(), 7.0f);
+    auto venus      = std::make_shared<Planet>("Venus",     0.34,   3.0,    2802.0, 100, ":/res/images/venus.bmp", randAngle(), 3.4f);
+    auto mars       = std::make_shared<Planet>("Mars",      0.453,  10.6,   24.7,   700, ":/res/images/mars.bmp", randAngle(), 1.85f);
+    auto jupiter    = std::make_shared<Planet>("Jupiter",   0.453,  13.32,  9.9,    3500, ":/res/images/jupiter.bmp", randAngle(), 1.3f);
+    auto saturn     = std::make_shared<Planet>("Saturn",    0.453,  15.92,  10.6,   10500, ":/res/images/saturn.bmp", randAngle(), 2.5f);
+
+    float saturnRadius = 0.453f;
+    auto saturnRing = std::make_shared<Ring>("Saturnring",
+                                            saturnRadius * 1.2f,
+                                            saturnRadius * 2.2f,
+                                            ":/res/images/ring.bmp",
+                                            26.7f);
+    saturn->setRing(saturnRing);
+
+    auto io         = std::make_shared<Planet>("Io",        0.036,  0.8,    10.6,   30, ":/res/images/moon.bmp", randAngle(), 0.04f);
+    auto europa     = std::make_shared<Planet>("Europa",    0.031,  1.0,    10.6,   60, ":/res/images/moon.bmp", randAngle(), 0.47f);
+    auto ganymede   = std::make_shared<Planet>("Ganymed",   0.052,  1.2,    10.6,   120, ":/res/images/moon.bmp", randAngle(), 0.2f);
+    auto callisto   = std::make_shared<Planet>("Callisto",  0.048,  1.8,    10.6,   350, ":/res/images/moon.bmp", randAngle(), 0.2f);
+
+    auto deathStar  = std::make_shared<DeathStar>("Todesstern", 0.315,  2.0,    27.3,    50, ":/res/images/moon.bmp", randAngle(), 2.0f);
+
+    _root->addChild(moon);
+    _root->addChild(sun);
+
+    sun->addChild(mercury);
+    sun->addChild(venus);
+    sun->addChild(mars);
+    sun->addChild(jupiter);
+    sun->addChild(saturn);
+    mars->addChild(deathStar);
+
+    jupiter->addChild(io);
+    jupiter->addChild(europa);
+    jupiter->addChild(ganymede);
+    jupiter->addChild(callisto);
+
+    _root->setLights(sun, deathStar->cone());
+    _root->setBodyBatch(_bodyBatch);
+    _bodyBatch->setLights(sun, deathStar->cone());
+
+    _hierarchy.compile(_root);
+}
+
+void Scene::build(const SceneOptions& options)
+{
+    if (options.synthetic)
+        buildSynthetic(options);
+    else
+    {
+        std::string file = options.file.empty()
+                ? (QCoreApplication::applicationDirPath() + "/scenes/solarsystem.scene").toStdString()
+                : options.file;
+        if (!load(file, options.seed))
+            buildSolarSystem(options.seed);
+    }
+    _paths = options.paths;
+}
+
+bool Scene::load(const std::string& path, unsigned int seed)
+{
+    qDebug() << "Scene::load() called with" << QString::fromStdString(path);
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug() << "Could not open scene file:" << QString::fromStdString(path);
+        return false;
+    }
+    qint64 size = file.size();
+    const uchar* data = file.map(0, size);
+    if (!data)
+    {
+        qDebug() << "Could not map scene file:" << QString::fromStdString(path);
+        return false;
+    }
+
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> degrees(0, 359);
+
+    // Bodies are created while the file is read; the vector only resolves parent indices.
+    std::vector<std::shared_ptr<Planet>> bodies;
+    std::shared_ptr<Sun> sun;
+    std::shared_ptr<Cone> laser;
+    auto create = [&](const scene_body& b) -> bool {
+        float startAngle = b.random_start_angle ? static_cast<float>(degrees(random)) : b.start_angle;
+        std::shared_ptr<Planet> body;
+        if (b.type == scene_sun)
+        {
+            auto s = std::make_shared<Sun>(b.name, b.radius, b.distance, b.hours_per_day, static_cast<float>(b.days_per_year),
+                                           b.texture, startAngle, b.inclination);
+            if (!sun)
+                sun = s;
+            body = s;
+        }
+        else if (b.type == scene_death_star)
+        {
+            auto d = std::make_shared<DeathStar>(b.name, b.radius, b.distance, b.hours_per_day, static_cast<float>(b.days_per_year),
+                                                 b.texture, startAngle, b.inclination);
+            if (!laser)
+                laser = d->cone();
+            body = d;
+        }
+        else
+            body = std::make_shared<Planet>(b.name, b.radius, b.distance, b.hours_per_day, b.days_per_year,
+                                            b.texture, startAngle, b.inclination);
+
+        if (!b.clouds.empty())
+            body->setCloudTexture(b.clouds);
+        if (b.has_ring)
+            body->setRing(std::make_shared<Ring>(b.name + "ring", b.ring_inner, b.ring_outer, b.ring_texture, b.ring_tilt));
+        if (b.parent >= 0)
+            bodies[b.parent]->addChild(body);
+        bodies.push_back(body);
+        return true;
+    };
+
+    std::string error;
+    bool ok = read_scene(reinterpret_cast<const char*>(data), static_cast<size_t>(size), create, error);
+    file.unmap(const_cast<uchar*>(data));
+    if (!ok)
+    {
+        qDebug() << "Invalid scene file" << QString::fromStdString(path) << ":" << QString::fromStdString(error);
+        return false;
+    }
+
+    _root = bodies.front();
+    _root->setLights(sun, laser);
+    _root->setBodyBatch(_bodyBatch);
+    _bodyBatch->setLights(sun, laser);
+    _hierarchy.compile(_root);
+
+    qDebug() << "Scene::load() built" << bodies.size() << "bodies in" << timer.elapsed() << "ms.";
+    return true;
+}
+
+void Scene::buildSynthetic(const SceneOptions& options)
+{
+    qDebug() << "Scene::buildSynthetic() called with" << options.bodies << "bodies, depth" << options.depth
+             << ", fan-out" << options.fanOut << ", seed" << options.seed;
+    std::mt19937 random(options.seed);
+    std::uniform_real_distribution<float> degrees(0.0f, 360.0f);
+    std::uniform_real_distribution<float> inclination(-8.0f, 8.0f);
+    std::uniform_real_distribution<float> hoursPerDay(5.0f, 500.0f);
+    std::uniform_int_distribution<unsigned int> daysPerYear(10, 1000);
+    std::uniform_int_distribution<size_t> texture(0, sizeof(s_bodyTextures) / sizeof(s_bodyTextures[0]) - 1);
+    std::bernoulli_distribution hasRing(std::min(std::max(options.ringFraction, 0.0f), 1.0f));
+
+    // Each body owns a sphere of 'extent' around it; its radius takes the inner tenth,
+    // the orbits of its children the rest.
+    struct Pending
+    {
+        std::shared_ptr<Planet> body;
+        unsigned int level;
+        float extent;
+    };
+
+    const float rootExtent = 40.0f;
+    auto sun = std::make_shared<Sun>("Sonne", 0.1f * rootExtent, 0.0f, 50.0f, 0, ":/res/images/sun.bmp", 0.0f, 0.0f);
+    _root = sun;
+
+    std::deque<Pending> queue;
+    queue.push_back(Pending{sun, 0, rootExtent});
+    unsigned int count = 1;
+    unsigned int rings = 0;
+    while (!queue.empty() && count < options.bodies)
+    {
+        Pending parent = queue.front();
+        queue.pop_front();
+        if (parent.level >= options.depth)
+            break;
+
+        unsigned int children = std::min(options.fanOut, options.bodies - count);
+        for (unsigned int i = 0; i < children; i++)
+        {
+            float distance = parent.extent * (0.2f + 0.8f * (i + 1) / (children + 1));
+            float extent = 0.4f * parent.extent / (children + 1);
+            float radius = 0.1f * extent;
+
+            auto body = std::make_shared<Planet>("Körper " + std::to_string(count), radius, distance,
+                                                 hoursPerDay(random), daysPerYear(random),
+                                                 s_bodyTextures[texture(random)], degrees(random), inclination(random));
+            if (hasRing(random))
+            {
+                body->setRing(std::make_shared<Ring>("Ring " + std::to_string(count), radius * 1.2f, radius * 2.2f,
+                                                     ":/res/images/ring.bmp", inclination(random) * 3.0f));
+                rings++;
+            }
+            parent.body->addChild(body);
+            queue.push_back(Pending{body, parent.level + 1, extent});
+            count++;
+        }
+    }
+    if (count < options.bodies)
+        qDebug() << "Scene::buildSynthetic(): depth and fan-out only allow" << count << "bodies.";
+
+    _root->setLights(sun, nullptr);
+    _root->setBodyBatch(_bodyBatch);
+    _bodyBatch->setLights(sun, nullptr);
+
+    _hierarchy.compile(_root);
+    qDebug() << "Scene::buildSynthetic() built" << count << "bodies with" << rings << "rings.";
+}
+
+void Scene::init()
+{
+    qDebug() << "Scene::init() called.";
+    if (_root)
+        _root->init();
+    _bodyBatch->init();
+    _coordSystem->init();
+    _skybox->init();
+
+    if (_root && _paths)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        _root->calculatePath(glm::mat4(1.0f));
+        qDebug() << "Scene::init() calculated the paths of" << bodyCount() << "bodies in" << timer.elapsed() << "ms.";
+    }
+}
+
+void Scene::startSimulation(float stepMs)
+{
+    _simulationStepMs = stepMs;
+    _simulationSuspended = false;
+    if (!_simulation)
+        _simulation.reset(new Simulation(_hierarchy, stepMs));
+}
+
+void Scene::stopSimulation()
+{
+    _simulationSuspended = false;
+    _simulation.reset();
+}
+
+Simulation* Scene::simulation() const
+{
+    return _simulation.get();
+}
+
+void Scene::update(float elapsedTimeMs, const glm::dmat4& viewMatrix)
+{
+    _rebuilder->processFinished();
+
+    const glm::mat4 floatViewMatrix(viewMatrix);
+
+    // The recursive update advances the bodies itself, so the thread stops while it is active
+    // and resumes from the angles it left.
+    if (_simulation && !Config::flatHierarchy)
+    {
+        _simulation.reset();
+        _simulationSuspended = true;
+    }
+    else if (_simulationSuspended && Config::flatHierarchy)
+    {
+        _hierarchy.pullRotations();
+        _recursiveUpdate = false;
+        startSimulation(_simulationStepMs);
+    }
+    if (_simulation)
+        _simulation->setSettings(FlatHierarchy::StepSettings::fromConfig());
+
+    if (_root)
+    {
+        if (Config::flatHierarchy && _simulation)
+            _simulation->evaluate(elapsedTimeMs, viewMatrix);
+        else if (Config::flatHierarchy)
+        {
+            // Continue from where the recursive update left the bodies.
+            if (_recursiveUpdate)
+                _hierarchy.pullRotations();
+            _hierarchy.update(elapsedTimeMs, viewMatrix);
+        }
+        else
+            _root->update(elapsedTimeMs, floatViewMatrix);
+        _recursiveUpdate = !Config::flatHierarchy;
+    }
+    _coordSystem->update(elapsedTimeMs, floatViewMatrix);
+    _skybox->update(elapsedTimeMs, floatViewMatrix);
+}
+
+void Scene::draw(const glm::mat4& projectionMatrix) const
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    _visibleBodies = _hierarchy.cull(projectionMatrix, static_cast<float>(viewport[3]), reversedDepth());
+
+    if (reversedDepth())
+    {
+        // Depth 1 at the near plane, falling towards the far plane, stored unchanged in [0, 1].
+        glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+        glClearDepth(0.0);
+        glDepthFunc(GL_GREATER);
+    }
+    else
+    {
+        if (GLEW_VERSION_4_5 || GLEW_ARB_clip_control)
+            glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+        glClearDepth(1.0);
+        glDepthFunc(GL_LESS);
+    }
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    if (Config::showWireframe)
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    else
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+    glDisable(GL_CULL_FACE);
+    if (_root)
+        _root->draw(projectionMatrix);
+    _bodyBatch->draw(projectionMatrix);
+    glEnable(GL_CULL_FACE);
+
+    if (Config::showCoordinateSystem)
+    {
+        glDisable(GL_DEPTH_TEST);
+        _coordSystem->draw(projectionMatrix);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    _skybox->draw(projectionMatrix);
+}
+
+void Scene::setResolution(unsigned int segments)
+{
+    if (_root)
+        _root->setResolution(segments);
+    _bodyBatch->setResolution(segments);
+}
+
+void Scene::requestResolution(unsigned int segments)
+{
+    _rebuilder->begin();
+    if (_root)
+        _root->requestResolution(segments, *_rebuilder);
+
+    // The spheres go last, in the same frame; with levels of detail they exist already.
+    MeshRebuilder::BuildFunction buildSphere;
+    if (!Config::sphereLod && !Config::proceduralMeshes)
+        buildSphere = [segments](MeshData& mesh) { SphereMesh::build(segments, mesh); };
+    std::shared_ptr<Planet> root = _root;
+    std::shared_ptr<BodyBatch> bodyBatch = _bodyBatch;
+    _rebuilder->add(buildSphere, [root, bodyBatch, segments](const MeshData& mesh) {
+        // Holds the new sphere in the cache while the bodies pick it up.
+        std::shared_ptr<SphereMesh> sphere;
+        if (!mesh.empty())
+            sphere = SphereMesh::get(segments, mesh);
+        if (root)
+            root->applySphereResolution(segments);
+        bodyBatch->applyMesh(segments, MeshData());
+    });
+}
+
+glm::mat4 Scene::projection(float aspectRatio)
+{
+    return projection(aspectRatio, reversedDepth());
+}
+
+glm::mat4 Scene::projection(float aspectRatio, bool reversed)
+{
+    const float fovy = glm::radians(50.0f);
+    const float zNear = 0.1f;
+    if (!reversed)
+        return glm::perspective(fovy, aspectRatio, zNear, 100.0f);
+
+    // Infinite far plane: z_clip = zNear, w_clip = -z_eye, so depth = zNear / -z_eye.
+    const float f = 1.0f / std::tan(fovy / 2.0f);
+    glm::mat4 projection(0.0f);
+    projection[0][0] = f / aspectRatio;
+    projection[1][1] = f;
+    projection[2][3] = -1.0f;
+    projection[3][2] = zNear;
+    return projection;
+}
+
+bool Scene::reversedDepth()
+{
+    return Config::reversedDepth && (GLEW_VERSION_4_5 || GLEW_ARB_clip_control);
+}
+
+size_t Scene::bodyCount() const
+{
+    return _hierarchy.size();
+}
+
+size_t Scene::visibleBodyCount() const
+{
+    return _visibleBodies;
+}
@@ -0,0 +1,221 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/mat4x4.hpp>
+
+#include "planets/flathierarchy.h"
+
+class Planet;
+class Skybox;
+class CoordinateSystem;
+class BodyBatch;
+class Simulation;
+class MeshRebuilder;
+
+/**
+ * @brief The SceneOptions struct selects and parameterizes the scene
+ *
+ * With --bodies a synthetic hierarchy below a sun is generated for stress
+ * tests. Otherwise the scene file given with --scene is loaded, by default
+ * scenes/solarsystem.scene next to the executable. Random start angles are
+ * reproducible from the seed.
+ */
+struct SceneOptions
+{
+    unsigned int seed = 1;
+    bool seeded = false;                /**< Whether --seed was given */
+
+    std::string file;                   /**< Scene description, see glbase/sceneload.hpp */
+
+    bool synthetic = false;
+    unsigned int bodies = 1000;         /**< Bodies including the sun at the root */
+    unsigned int depth = 3;             /**< Levels below the sun */
+    unsigned int fanOut = 8;            /**< Children per body */
+    float ringFraction = 0.02f;         /**< Share of the bodies with a ring */
+    bool paths = false;                 /**< Whether init() calculates the paths of all bodies */
+
+    /**
+     * @brief parse Reads --seed, --scene, --bodies, --depth, --fanout, --rings and --paths
+     *
+     * Other arguments are ignored, so the list may hold those of Qt or the benchmark.
+     */
+    static SceneOptions parse(const std::vector<std::string>& arguments);
+};
+
+/**
+ * @brief The Scene class owns everything that is drawn
+ *
+ * It holds the body tree with its flattened copy, the body batch, the skybox
+ * and the coordinate system, and updates and draws them in the right order.
+ * The window and the headless benchmark both render through it.
+ *
+ * init() and the destruction of the scene need the GL context current;
+ * initResources() and releaseResources() set up and tear down the
+ * process-wide loaders and caches around the first and last scene.
+ */
+class Scene
+{
+public:
+    Scene();
+
+    ~Scene();
+
+    /**
+     * @brief initResources Opens the asset bundle and sets the cache directories
+     */
+    static void initResources();
+
+    /**
+     * @brief releaseResources Deletes the GL objects of the loaders and caches
+     *
+     * Call with the GL context current, after all scenes are destroyed.
+     */
+    static void releaseResources();
+
+    /**
+     * @brief build Builds the scene selected by the options
+     */
+    void build(const SceneOptions& options);
+
+    /**
+     * @brief load Builds the scene from a text or binary scene description
+     * @param path the file, see glbase/sceneload.hpp
+     * @param seed seeds the start angles the file leaves open
+     * @return false if the file cannot be read; the scene is left empty then
+     */
+    bool load(const std::string& path, unsigned int seed);
+
+    /**
+     * @brief buildSolarSystem Builds the built-in solar system around the earth
+     * @param seed seeds the start angles of the bodies, so equal seeds give equal scenes
+     *
+     * Used when no scene file can be loaded.
+     */
+    void buildSolarSystem(unsigned int seed);
+
+    /**
+     * @brief buildSynthetic Builds a generated hierarchy below a sun
+     *
+     * The tree is filled breadth first, every body getting up to fanOut children,
+     * until it holds options.bodies bodies or reaches options.depth levels.
+     * Orbits are spaced so that the subtrees of siblings do not overlap.
+     */
+    void buildSynthetic(const SceneOptions& options);
+
+    /**
+     * @brief init Creates the GL objects of all drawables
+     */
+    void init();
+
+    /**
+     * @brief update Advances the scene, or interpolates it while the simulation thread runs
+     *
+     * Also applies a finished requestResolution(). While Config::flatHierarchy
+     * is off, the simulation thread is stopped and the recursive update runs.
+     * @param elapsedTimeMs the elapsed time in milliseconds
+     * @param viewMatrix the camera matrix, in double precision so that the
+     *        bodies can be placed relative to the camera before converting to float
+     */
+    void update(float elapsedTimeMs, const glm::dmat4& viewMatrix);
+
+    /**
+     * @brief startSimulation Moves the simulation of the hierarchy to its own thread
+     *
+     * update() then only interpolates between the fixed steps of the thread.
+     * Does nothing while the simulation runs already.
+     * @param stepMs the fixed time step in milliseconds
+     */
+    void startSimulation(float stepMs);
+
+    /**
+     * @brief stopSimulation Stops the simulation thread; update() advances the scene itself again
+     */
+    void stopSimulation();
+
+    /**
+     * @brief simulation Getter for the running simulation, or nullptr
+     */
+    Simulation* simulation() const;
+
+    /**
+     * @brief draw Clears the bound framebuffer and draws the scene
+     *
+     * The hierarchy is culled against the projection and the current viewport
+     * first, which also picks the sphere levels of detail, see FlatHierarchy::cull().
+     * @param projectionMatrix the current projection matrix
+     */
+    void draw(const glm::mat4& projectionMatrix) const;
+
+    /**
+     * @brief setResolution Rebuilds the body meshes with the given number of segments
+     */
+    void setResolution(unsigned int segments);
+
+    /**
+     * @brief requestResolution Rebuilds the meshes for a resolution on worker threads
+     *
+     * Returns at once; the first update() after all meshes are built swaps
+     * them in together. A newer request drops an unfinished one.
+     */
+    void requestResolution(unsigned int segments);
+
+    /**
+     * @brief projection Returns the projection matrix for an aspect ratio
+     *
+     * With reversed depth the far plane is at infinity and maps to depth 0,
+     * the near plane to depth 1.
+     */
+    static glm::mat4 projection(float aspectRatio);
+
+    /**
+     * @brief projection Same as above, with or without reversed depth regardless of the context
+     */
+    static glm::mat4 projection(float aspectRatio, bool reversed);
+
+    /**
+     * @brief reversedDepth Whether the scene is drawn with reversed depth
+     *
+     * Requires Config::reversedDepth and glClipControl (GL 4.5 or
+     * ARB_clip_control) to map clip space depth to [0, 1]. Needs an
+     * initialized GLEW. It only gains precision with a float depth buffer,
+     * so the window and the benchmark then draw into a framebuffer object
+     * with GL_DEPTH_COMPONENT32F.
+     */
+    static bool reversedDepth();
+
+    /**
+     * @brief bodyCount Getter for the number of bodies in the tree
+     */
+    size_t bodyCount() const;
+
+    /**
+     * @brief visibleBodyCount Getter for the number of bodies the last draw() did not cull
+     */
+    size_t visibleBodyCount() const;
+
+private:
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    std::shared_ptr<Planet> _root;
+    std::shared_ptr<Skybox> _skybox;
+    std::shared_ptr<CoordinateSystem> _coordSystem;
+    std::shared_ptr<BodyBatch> _bodyBatch;
+
+    FlatHierarchy _hierarchy;
+    bool _recursiveUpdate = false;             /**< The last update() ran Planet::update(), not the hierarchy */
+    bool _paths = false;
+    mutable size_t _visibleBodies = 0;
+
+    std::unique_ptr<Simulation> _simulation;
+    bool _simulationSuspended = false;         /**< Stopped by update() while Config::flatHierarchy is off */
+    float _simulationStepMs = 0.0f;
+    std::unique_ptr<MeshRebuilder> _rebuilder;
+};
+
+#endif // SCENE_H
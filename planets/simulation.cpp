@@ -0,0 +1,138 @@
+#include "planets/simulation.h"
+
+#include <algorithm>
+
+#include <QDebug>
+
+namespace {
+    // More steps than this behind the wall clock are dropped.
+    const unsigned int s_maxCatchUpSteps = 5;
+
+    double lerpDegrees(double a, double b, double t)
+    {
+        double delta = b - a;
+        if (delta > 180.0)
+            delta -= 360.0;
+        else if (delta < -180.0)
+            delta += 360.0;
+        double angle = a + t * delta;
+        return angle < 0.0 ? angle + 360.0 : (angle >= 360.0 ? angle - 360.0 : angle);
+    }
+}
+
+Simulation::Simulation(FlatHierarchy& hierarchy, float stepMs) :
+    _hierarchy(hierarchy),
+    _stepMs(std::max(stepMs, 0.1f)),
+    _settings(FlatHierarchy::StepSettings::fromConfig())
+{
+    qDebug() << "Simulation constructor called with step:" << _stepMs << "ms";
+    _previousGlobal = _currentGlobal = _hierarchy.globalRotations();
+    _previousLocal = _currentLocal = _hierarchy.localRotations();
+    _start = _statisticsStart = Clock::now();
+    _thread = std::thread(&Simulation::run, this);
+}
+
+Simulation::~Simulation()
+{
+    qDebug() << "Simulation destructor called.";
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    _thread.join();
+}
+
+void Simulation::run()
+{
+    const std::chrono::duration<double, std::milli> step(_stepMs);
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stop)
+    {
+        Clock::time_point due = _start + std::chrono::duration_cast<Clock::duration>(step * (_step + 1));
+        if (_wake.wait_until(lock, due, [this]() { return _stop; }))
+            break;
+
+        // Steps that are too far behind are dropped by moving the start forward.
+        Clock::time_point now = Clock::now();
+        double behind = std::chrono::duration<double, std::milli>(now - due).count() / _stepMs;
+        if (behind > s_maxCatchUpSteps)
+        {
+            unsigned long long dropped = static_cast<unsigned long long>(behind) - s_maxCatchUpSteps;
+            _start += std::chrono::duration_cast<Clock::duration>(step * dropped);
+            _droppedSteps += dropped;
+        }
+
+        // Only this thread touches the angles of the hierarchy, so the step runs unlocked.
+        const FlatHierarchy::StepSettings settings = _settings;
+        lock.unlock();
+        Clock::time_point stepStart = Clock::now();
+        _hierarchy.step(_stepMs, settings);
+        double stepSeconds = std::chrono::duration<double>(Clock::now() - stepStart).count();
+        lock.lock();
+
+        _previousGlobal.swap(_currentGlobal);
+        _previousLocal.swap(_currentLocal);
+        _currentGlobal = _hierarchy.globalRotations();
+        _currentLocal = _hierarchy.localRotations();
+        _step++;
+        _statisticsSteps++;
+        _stepSeconds += stepSeconds;
+    }
+}
+
+void Simulation::evaluate(float elapsedTimeMs, const glm::dmat4& viewMatrix)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Frames show the time one step ago, between the previous and the current step.
+        double now = std::chrono::duration<double, std::milli>(Clock::now() - _start).count();
+        double previousTime = (_step - 1.0) * _stepMs;
+        double t = std::min(std::max((now - _stepMs - previousTime) / _stepMs, 0.0), 1.0);
+
+        const size_t count = _currentGlobal.size();
+        _renderGlobal.resize(count);
+        _renderLocal.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            _renderGlobal[i] = lerpDegrees(_previousGlobal[i], _currentGlobal[i], t);
+            _renderLocal[i] = lerpDegrees(_previousLocal[i], _currentLocal[i], t);
+        }
+
+        double lag = now - (previousTime + t * _stepMs);
+        _frames++;
+        _lagSum += lag;
+        _lagMax = std::max(_lagMax, lag);
+    }
+
+    _hierarchy.evaluate(elapsedTimeMs, viewMatrix, _renderGlobal, _renderLocal);
+}
+
+void Simulation::setSettings(const FlatHierarchy::StepSettings& settings)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _settings = settings;
+}
+
+void Simulation::logStatistics()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Clock::time_point now = Clock::now();
+    double seconds = std::chrono::duration<double>(now - _statisticsStart).count();
+    if (seconds <= 0.0)
+        return;
+
+    qDebug() << "Simulation:" << _statisticsSteps / seconds << "steps/s,"
+             << (_statisticsSteps > 0 ? 1000.0 * _stepSeconds / _statisticsSteps : 0.0) << "ms per step,"
+             << _droppedSteps << "dropped," << _frames / seconds << "frames/s, interpolation lag"
+             << (_frames > 0 ? _lagSum / _frames : 0.0) << "ms (max" << _lagMax << "ms).";
+
+    _statisticsStart = now;
+    _statisticsSteps = 0;
+    _droppedSteps = 0;
+    _stepSeconds = 0.0;
+    _frames = 0;
+    _lagSum = 0.0;
+    _lagMax = 0.0;
+}
@@ -0,0 +1,103 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/mat4x4.hpp>
+
+#include "planets/flathierarchy.h"
+
+/**
+ * @brief The Simulation class advances a FlatHierarchy at a fixed rate on its own thread
+ *
+ * The thread calls FlatHierarchy::step() every stepMs of wall time and
+ * publishes the angles of the last two steps. The render thread calls
+ * evaluate() once per frame, which interpolates between them and computes
+ * the matrices. Rendering runs one step behind the simulation, so frames
+ * show smooth motion at any frame rate, and a slow step delays only the
+ * simulation, not the presentation of frames.
+ *
+ * If the thread falls more than a few steps behind, the missed time is
+ * dropped instead of caught up, so the simulation slows down rather than
+ * spiralling.
+ *
+ * The hierarchy must not be compiled or updated elsewhere while the
+ * simulation runs.
+ */
+class Simulation
+{
+public:
+    /**
+     * @brief Simulation Starts the simulation thread
+     * @param hierarchy the compiled hierarchy to advance
+     * @param stepMs the simulated and wall time per step in milliseconds
+     */
+    Simulation(FlatHierarchy& hierarchy, float stepMs);
+
+    /**
+     * @brief ~Simulation Stops and joins the thread
+     */
+    ~Simulation();
+
+    /**
+     * @brief evaluate Interpolates the last two steps for the current time and updates the bodies
+     * @param elapsedTimeMs the wall time since the last frame, for the attachments
+     * @param viewMatrix the camera matrix
+     */
+    void evaluate(float elapsedTimeMs, const glm::dmat4& viewMatrix);
+
+    /**
+     * @brief setSettings Hands the current Config to the thread for its next steps
+     * @param settings a copy taken on the GUI thread, see FlatHierarchy::StepSettings::fromConfig()
+     */
+    void setSettings(const FlatHierarchy::StepSettings& settings);
+
+    /**
+     * @brief logStatistics Prints the steps per second, step cost and interpolation lag
+     *        since the last call with qDebug() and resets the counters
+     */
+    void logStatistics();
+
+private:
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    typedef std::chrono::steady_clock Clock;
+
+    void run();
+
+    FlatHierarchy& _hierarchy;
+    const float _stepMs;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stop = false;                        // guarded by _mutex
+    FlatHierarchy::StepSettings _settings;     // guarded by _mutex
+
+    // Published state, guarded by _mutex
+    Clock::time_point _start;                  /**< Wall time of simulated time 0, moved on dropped steps */
+    unsigned long long _step = 0;              /**< Index of the step in _current */
+    std::vector<double> _previousGlobal, _previousLocal;
+    std::vector<double> _currentGlobal, _currentLocal;
+
+    // Statistics, guarded by _mutex
+    Clock::time_point _statisticsStart;
+    unsigned long long _statisticsSteps = 0;
+    unsigned long long _droppedSteps = 0;
+    double _stepSeconds = 0.0;
+    unsigned long long _frames = 0;
+    double _lagSum = 0.0;
+    double _lagMax = 0.0;
+
+    // Render thread only
+    std::vector<double> _renderGlobal, _renderLocal;
+
+    std::thread _thread;
+};
+
+#endif // SIMULATION_H
@@ -6,7 +6,8 @@
 #include <glm/mat3x3.hpp>
 
 #include "glbase/gltool.hpp"
-#include "image/image.h"
+#include "planets/scene.h"
+#include "planets/textureloader.h"
 
 #include <vector>
 #include <iostream>
@@ -37,21 +38,17 @@ void Skybox::draw(glm::mat4 projection_matrix) const
     GLboolean isCulling;
     glGetBooleanv(GL_CULL_FACE, &isCulling);
 
-    glDepthFunc(GL_LEQUAL);
+    // The sky lies on the far plane, which passes the test only including equality.
+    glDepthFunc(currentDepthFunc == GL_GREATER ? GL_GEQUAL : GL_LEQUAL);
     glDisable(GL_CULL_FACE);
 
     glUseProgram(_program);
 
-    GLint viewLoc = glGetUniformLocation(_program, "view");
-    GLint projLoc = glGetUniformLocation(_program, "projection");
-    GLint skyboxLoc = glGetUniformLocation(_program, "skybox");
-
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(_modelViewMatrix));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection_matrix));
+    glUniformMatrix4fv(uniform(U_VIEW), 1, GL_FALSE, glm::value_ptr(_modelViewMatrix));
+    glUniformMatrix4fv(uniform(U_PROJECTION), 1, GL_FALSE, glm::value_ptr(projection_matrix));
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, s_cubemapTextureID);
-    glUniform1i(skyboxLoc, 0);
 
     glBindVertexArray(_vertexArrayObject);
     glDrawArrays(GL_TRIANGLES, 0, 36);
@@ -80,6 +77,11 @@ std::string Skybox::getFragmentShader() const
     return loadShaderFile(":/shader/skybox.fs.glsl");
 }
 
+std::string Skybox::getShaderDefines() const
+{
+    return Scene::reversedDepth() ? "#define REVERSED_Z 1\n" : "";
+}
+
 void Skybox::loadTexture()
 {
     qDebug() << "Skybox::loadTexture() called.";
@@ -95,18 +97,37 @@ void Skybox::loadTexture()
         ":/shader/skybox/nz.png"
     };
 
+    // Black placeholders until the faces are decoded in the background.
+    const GLubyte placeholder[4] = { 0, 0, 0, 255 };
     for (unsigned int i = 0; i < faces.size(); i++)
     {
-        Image image(faces[i]);
-        if (image.getData())
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                         0, GL_RGBA, image.getWidth(), image.getHeight(), 0, GL_RGBA, GL_UNSIGNED_BYTE, image.getData());
-        }
-        else
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+                     0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+    }
+
+    // While the faces differ in size the cube map is incomplete and samples black like the placeholders.
+    GLuint textureID = s_cubemapTextureID;
+    for (unsigned int i = 0; i < faces.size(); i++)
+    {
+        TextureLoader::instance().request(faces[i], false, [textureID, i](const DecodedImage& image, const std::vector<const GLvoid*>& levels)
         {
-            qDebug() << "Cubemap Textur konnte nicht geladen werden:" << QString::fromStdString(faces[i]);
-        }
+            if (levels.empty())
+            {
+                qDebug() << "Cubemap Textur konnte nicht geladen werden:" << QString::fromStdString(image.path);
+                return;
+            }
+            if (textureID != s_cubemapTextureID)
+                return;
+
+            glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+            if (image.internalFormat != GL_RGBA8)
+                glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, image.internalFormat,
+                                       image.width, image.height, 0, static_cast<GLsizei>(image.size()), levels[0]);
+            else
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+                             0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[0]);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        });
     }
 
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -20,6 +20,8 @@ protected:
 
     virtual std::string getFragmentShader() const override;
 
+    virtual std::string getShaderDefines() const override;
+
     virtual void createObject() override;
 
     virtual void loadTexture();
@@ -0,0 +1,209 @@
+#include "planets/spheremesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "glbase/geometries.hpp"
+#include "glbase/gltool.hpp"
+#include "gui/config.h"
+#include "planets/meshdata.h"
+
+#include <QDebug>
+
+std::map<unsigned int, std::weak_ptr<SphereMesh>> SphereMesh::s_meshes;
+
+std::shared_ptr<SphereMesh> SphereMesh::get(unsigned int segments)
+{
+    if (segments < 3)
+        segments = 3;
+
+    std::shared_ptr<SphereMesh> mesh = s_meshes[segments].lock();
+    if (!mesh)
+    {
+        MeshData data;
+        build(segments, data);
+        data.pack();
+        mesh = std::shared_ptr<SphereMesh>(new SphereMesh(segments, data));
+        s_meshes[segments] = mesh;
+    }
+    return mesh;
+}
+
+std::shared_ptr<SphereMesh> SphereMesh::get(unsigned int segments, const MeshData& prebuilt)
+{
+    if (segments < 3)
+        segments = 3;
+
+    std::shared_ptr<SphereMesh> mesh = s_meshes[segments].lock();
+    if (!mesh)
+    {
+        mesh = std::shared_ptr<SphereMesh>(new SphereMesh(segments, prebuilt));
+        s_meshes[segments] = mesh;
+    }
+    return mesh;
+}
+
+void SphereMesh::build(unsigned int segments, MeshData& mesh)
+{
+    build(segments, mesh, Config::sphereMesh);
+}
+
+void SphereMesh::build(unsigned int segments, MeshData& mesh, Config::SphereMesh type)
+{
+    segments = std::max(segments, 3u);
+    if (type == Config::IcoSphere)
+    {
+        // Each subdivision halves the edges; 2^(level + 2) segments deviate as much.
+        int subdivisions = 0;
+        while ((4u << subdivisions) < segments)
+            ++subdivisions;
+        geom_icosphere(mesh.positions, mesh.normals, mesh.texCoords, mesh.indices, subdivisions);
+    }
+    else if (type == Config::CubeSphere)
+    {
+        int subdivisions = 2 * static_cast<int>(std::ceil(0.17f * segments));
+        geom_cubesphere(mesh.positions, mesh.normals, mesh.texCoords, mesh.indices, subdivisions);
+    }
+    else
+    {
+        buildUVSphere(segments, mesh);
+    }
+
+    if (Config::vertexCacheOrder)
+        mesh.indices = optimize_vertex_cache(mesh.indices, mesh.positions.size());
+}
+
+void SphereMesh::buildUVSphere(unsigned int segments, MeshData& mesh)
+{
+    unsigned int latitudeSegments = segments;
+    unsigned int longitudeSegments = segments;
+
+    mesh.reserve((latitudeSegments + 1) * (longitudeSegments + 1), 6 * latitudeSegments * longitudeSegments);
+    for (unsigned int i = 0; i <= latitudeSegments; ++i)
+    {
+        float v = (float)i / latitudeSegments;
+        float latitudeAngle = glm::radians(-90.0f + v * 180.0f);
+        for (unsigned int j = 0; j <= longitudeSegments; ++j)
+        {
+            float u = (float)j / longitudeSegments;
+            float longitudeAngle = glm::radians(u * 360.0f);
+            float x = cos(latitudeAngle) * cos(longitudeAngle);
+            float y = sin(latitudeAngle);
+            float z = cos(latitudeAngle) * sin(longitudeAngle);
+            mesh.positions.push_back(glm::vec3(x, y, z));
+            mesh.normals.push_back(glm::normalize(glm::vec3(x, y, z)));
+            mesh.texCoords.push_back(glm::vec2(u, 1.0f - v));
+        }
+    }
+    for (unsigned int i = 0; i < latitudeSegments; ++i)
+    {
+        for (unsigned int j = 0; j < longitudeSegments; ++j)
+        {
+            unsigned int v1 = (i * (longitudeSegments + 1)) + j;
+            unsigned int v2 = v1 + 1;
+            unsigned int v3 = ((i + 1) * (longitudeSegments + 1)) + j;
+            unsigned int v4 = v3 + 1;
+            mesh.indices.push_back(v1);
+            mesh.indices.push_back(v3);
+            mesh.indices.push_back(v2);
+            mesh.indices.push_back(v2);
+            mesh.indices.push_back(v3);
+            mesh.indices.push_back(v4);
+        }
+    }
+}
+
+unsigned int SphereMesh::lodSegments(unsigned int level)
+{
+    return 8u << level;
+}
+
+unsigned int SphereMesh::lodLevel(float radiusPixels)
+{
+    // Largest gap between a segment and the sphere: r * (1 - cos(pi / segments)).
+    for (unsigned int level = 0; level + 1 < s_lodLevels; ++level)
+    {
+        float sagitta = radiusPixels * (1.0f - std::cos(glm::pi<float>() / lodSegments(level)));
+        if (sagitta <= Config::lodPixelError)
+            return level;
+    }
+    return s_lodLevels - 1;
+}
+
+unsigned int SphereMesh::lodCap(unsigned int segments)
+{
+    unsigned int level = 0;
+    while (level + 1 < s_lodLevels && lodSegments(level) < segments)
+        ++level;
+    return level;
+}
+
+SphereMesh::SphereMesh(unsigned int segments, const MeshData& mesh):
+    _segments(segments)
+{
+    qDebug() << "SphereMesh constructor called with segments:" << segments;
+    _indexCount = static_cast<unsigned int>(mesh.indexCount());
+    _indexType = mesh.indexType();
+    _vertexBytes = mesh.vertices.size() * sizeof(PackedVertex);
+    _indexBytes = mesh.indexBytes();
+
+    glGenBuffers(1, &_vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, _vertexBytes, mesh.vertices.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &_indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indexBytes, mesh.indexData(), GL_STATIC_DRAW);
+
+    glGenVertexArrays(1, &_vertexArrayObject);
+    glBindVertexArray(_vertexArrayObject);
+    setupAttributes();
+    glBindVertexArray(0);
+    MeshData::countBufferBytes(static_cast<long long>(bufferBytes()));
+    VERIFY(CG::checkError());
+}
+
+SphereMesh::~SphereMesh()
+{
+    MeshData::countBufferBytes(-static_cast<long long>(bufferBytes()));
+    glDeleteVertexArrays(1, &_vertexArrayObject);
+    glDeleteBuffers(1, &_vertexBuffer);
+    glDeleteBuffers(1, &_indexBuffer);
+}
+
+void SphereMesh::bind() const
+{
+    glBindVertexArray(_vertexArrayObject);
+}
+
+void SphereMesh::setupAttributes() const
+{
+    glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+    MeshData::setupAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+}
+
+unsigned int SphereMesh::indexCount() const
+{
+    return _indexCount;
+}
+
+GLenum SphereMesh::indexType() const
+{
+    return _indexType;
+}
+
+size_t SphereMesh::bufferBytes() const
+{
+    return _vertexBytes + _indexBytes;
+}
+
+unsigned int SphereMesh::segments() const
+{
+    return _segments;
+}
@@ -0,0 +1,141 @@
+#ifndef SPHEREMESH_H
+#define SPHEREMESH_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+#include <GL/glew.h>
+
+#include "gui/config.h"
+
+struct MeshData;
+
+/**
+ * @brief The SphereMesh class holds the GPU buffers of a unit sphere
+ *
+ * All bodies with the same resolution share one mesh through get() and
+ * scale it by their radius when drawing. The mesh owns a vertex array
+ * object with positions (location 0), normals (1) and texture
+ * coordinates (2), interleaved as PackedVertex; other vertex arrays can
+ * reuse its buffers through setupAttributes(), e.g. to add per-instance
+ * attributes.
+ *
+ * For screen-space level of detail a fixed chain of resolutions is kept,
+ * lodSegments(0) to lodSegments(s_lodLevels - 1), each level doubling the
+ * segments of the previous one. lodLevel() picks the coarsest level whose
+ * silhouette stays within Config::lodPixelError of the true sphere.
+ *
+ * Config::sphereMesh selects the tessellation. The icosphere and the cube
+ * sphere of a resolution are chosen to deviate from the sphere no more
+ * than the latitude/longitude sphere with that many segments, with about
+ * 35% and 20% fewer vertices. With Config::vertexCacheOrder the triangles
+ * are reordered for the post-transform vertex cache.
+ */
+class SphereMesh
+{
+public:
+    /**
+     * @brief get Returns the shared mesh for a resolution
+     * @param segments the number of latitude and longitude segments
+     * @return the mesh, created on first use; needs a current GL context
+     */
+    static std::shared_ptr<SphereMesh> get(unsigned int segments);
+
+    /**
+     * @brief get Returns the shared mesh for a resolution, uploading prebuilt geometry if it is new
+     * @param segments the number of latitude and longitude segments
+     * @param prebuilt the geometry from build() for the same resolution, packed
+     */
+    static std::shared_ptr<SphereMesh> get(unsigned int segments, const MeshData& prebuilt);
+
+    /**
+     * @brief build Generates the geometry of a unit sphere; needs no GL context
+     */
+    static void build(unsigned int segments, MeshData& mesh);
+
+    /**
+     * @brief build Generates the geometry of a unit sphere with a given tessellation
+     */
+    static void build(unsigned int segments, MeshData& mesh, Config::SphereMesh type);
+
+    static const unsigned int s_lodLevels = 5;
+
+    /**
+     * @brief lodSegments Returns the resolution of a level of detail
+     * @param level the level, 0 being the coarsest
+     */
+    static unsigned int lodSegments(unsigned int level);
+
+    /**
+     * @brief lodLevel Returns the coarsest level that looks round at a projected radius
+     * @param radiusPixels the radius of the sphere on screen in pixels
+     */
+    static unsigned int lodLevel(float radiusPixels);
+
+    /**
+     * @brief lodCap Returns the coarsest level with at least the given resolution
+     * @param segments the resolution the user asked for; coarser levels may be drawn, but no finer ones
+     */
+    static unsigned int lodCap(unsigned int segments);
+
+    ~SphereMesh();
+
+    /**
+     * @brief bind Binds the vertex array object of the mesh
+     */
+    void bind() const;
+
+    /**
+     * @brief setupAttributes Attaches the mesh buffers to the bound vertex array
+     */
+    void setupAttributes() const;
+
+    /**
+     * @brief indexCount Getter for the number of indices
+     * @return the index count for glDrawElements() in GL_TRIANGLES mode
+     */
+    unsigned int indexCount() const;
+
+    /**
+     * @brief indexType Getter for the index type, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+     */
+    GLenum indexType() const;
+
+    /**
+     * @brief segments Getter for the resolution of the mesh
+     * @return the number of latitude and longitude segments
+     */
+    unsigned int segments() const;
+
+    /**
+     * @brief bufferBytes Getter for the size of the vertex and index buffer
+     */
+    size_t bufferBytes() const;
+
+private:
+    SphereMesh(unsigned int segments, const MeshData& mesh);
+
+    static void buildUVSphere(unsigned int segments, MeshData& mesh);
+
+    SphereMesh(const SphereMesh&) = delete;
+    SphereMesh& operator=(const SphereMesh&) = delete;
+
+    static std::map<unsigned int, std::weak_ptr<SphereMesh>> s_meshes;
+
+    unsigned int _segments;
+    unsigned int _indexCount = 0;
+    GLenum _indexType = GL_UNSIGNED_INT;
+    size_t _vertexBytes = 0;
+    size_t _indexBytes = 0;
+
+    GLuint _vertexArrayObject = 0;
+    GLuint _vertexBuffer = 0;
+    GLuint _indexBuffer = 0;
+};
+
+#endif // SPHEREMESH_H
@@ -67,9 +67,24 @@ void Sun::update(float elapsedTimeMs, glm::mat4 modelViewMatrix)
     Config::GlobalRotation = originalGlobalRotationState;
 }
 
+void Sun::updateAttachments(float elapsedTimeMs, const glm::mat4& parentMatrix,
+                            const glm::mat4& orbitMatrix, const glm::mat4& anchorMatrix)
+{
+    // Like Sun::update(): the sun has no clouds to animate and no ring.
+    _orbit->update(elapsedTimeMs, orbitMatrix);
+    _path->update(elapsedTimeMs, parentMatrix);
+}
+
+bool Sun::isInstanceable() const
+{
+    // The sun is unlit and uses its own shader.
+    return false;
+}
+
 std::string Sun::getVertexShader() const
 {
-    return Drawable::loadShaderFile(":/shader/sun.vs.glsl");
+    std::string source = Drawable::loadShaderFile(":/shader/sun.vs.glsl");
+    return Config::proceduralMeshes ? proceduralVertexShader(source) : source;
 }
 
 std::string Sun::getFragmentShader() const
@@ -20,7 +20,11 @@ public:
 
     virtual void update(float elapsedTimeMs, glm::mat4 modelViewMatrix) override;
 
+    virtual bool isInstanceable() const override;
+
 protected:
+    virtual void updateAttachments(float elapsedTimeMs, const glm::mat4& parentMatrix,
+                                   const glm::mat4& orbitMatrix, const glm::mat4& anchorMatrix) override;
     virtual std::string getVertexShader() const override;
     virtual std::string getFragmentShader() const override;
 };
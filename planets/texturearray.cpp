@@ -0,0 +1,208 @@
+#include "planets/texturearray.h"
+
+#include <algorithm>
+
+#include <QImage>
+#include <QDebug>
+
+#include "glbase/gltool.hpp"
+#include "gui/config.h"
+#include "planets/texturecache.h"
+#include "planets/textureloader.h"
+
+TextureArray::TextureArray()
+{
+}
+
+TextureArray::~TextureArray()
+{
+    TextureLoader::instance().cancel(this);
+    if (_textureID != 0)
+        glDeleteTextures(1, &_textureID);
+}
+
+int TextureArray::addLayer(const std::string& path)
+{
+    auto it = _layers.find(path);
+    if (it != _layers.end())
+    {
+        ++_requests[it->second];
+        return it->second;
+    }
+
+    int layer = static_cast<int>(_paths.size());
+    _layers[path] = layer;
+    _paths.push_back(path);
+    _requests.push_back(1);
+    return layer;
+}
+
+void TextureArray::build()
+{
+    qDebug() << "TextureArray::build() called with" << _paths.size() << "layers.";
+    if (_paths.empty())
+        return;
+
+    // Grey placeholder layers until all images are decoded.
+    std::vector<GLubyte> placeholder(_paths.size() * 4, 128);
+    if (_textureID == 0)
+        glGenTextures(1, &_textureID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, _textureID);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, 1, 1, static_cast<GLsizei>(_paths.size()),
+                 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder.data());
+
+    // Repeats in s like Planet::loadTexture(), for the seam of the icosphere and cube sphere.
+    TextureSampler sampler;
+    sampler.wrapS = GL_REPEAT;
+    sampler.apply(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    VERIFY(CG::checkError());
+
+    TextureLoader::instance().cancel(this);
+    _images.assign(_paths.size(), DecodedImage());
+    _outstanding = static_cast<unsigned int>(_paths.size());
+    for (size_t layer = 0; layer < _paths.size(); ++layer)
+    {
+        TextureLoader::instance().request(_paths[layer], true, [this, layer](const DecodedImage& image, const std::vector<const GLvoid*>&)
+        {
+            // The layer size is only known once every image is decoded, so keep a CPU copy until then.
+            _images[layer] = image;
+            if (--_outstanding == 0)
+            {
+                // upload() passes the CPU copies, not 'levels'; the loader's unpack buffer may still be bound.
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                upload();
+            }
+        }, this);
+    }
+}
+
+void TextureArray::upload()
+{
+    // A compressed array needs every layer in one format and size with the same mip chain;
+    // otherwise compressed layers are decompressed and scaled like all others.
+    GLenum format = _images[0].internalFormat;
+    bool compressed = (format != GL_RGBA8);
+    for (const DecodedImage& image : _images)
+        compressed = compressed && image.internalFormat == format && image.width == _images[0].width
+                && image.height == _images[0].height && image.mipmaps.size() == _images[0].mipmaps.size();
+    if (!compressed)
+    {
+        format = GL_RGBA8;
+        for (DecodedImage& image : _images)
+        {
+            if (!TextureLoader::decompress(image))
+            {
+                qDebug() << "Could not decompress texture file:" << QString::fromStdString(image.path);
+                image = DecodedImage();
+            }
+        }
+    }
+
+    int width = 1;
+    int height = 1;
+    for (const DecodedImage& image : _images)
+    {
+        width = std::max(width, image.width);
+        height = std::max(height, image.height);
+    }
+
+    GLint maxSize;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    width = std::min(width, static_cast<int>(maxSize));
+    height = std::min(height, static_cast<int>(maxSize));
+
+    // Prebuilt mip chains can only be used if no layer needs scaling.
+    bool prebuiltMipmaps = true;
+    for (const DecodedImage& image : _images)
+        prebuiltMipmaps = prebuiltMipmaps && image.width == width && image.height == height && !image.mipmaps.empty();
+    GLsizei levelCount = 1;
+    if (Config::mipmaps && compressed)
+        levelCount += static_cast<GLsizei>(_images[0].mipmaps.size());
+    else if (Config::mipmaps)
+        while ((std::max(width, height) >> levelCount) > 0)
+            ++levelCount;
+
+    GLsizei layerCount = static_cast<GLsizei>(_paths.size());
+    size_t arrayBytes = 0;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, _textureID);
+    for (GLsizei level = 0; level < levelCount; ++level)
+    {
+        GLsizei levelWidth = std::max(1, width >> level);
+        GLsizei levelHeight = std::max(1, height >> level);
+        if (compressed)
+        {
+            size_t size = (level == 0 ? _images[0].size() : _images[0].mipmaps[level - 1].size());
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, levelWidth, levelHeight, layerCount, 0,
+                                   static_cast<GLsizei>(size * layerCount), nullptr);
+            arrayBytes += size * layerCount;
+        }
+        else
+        {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, levelWidth, levelHeight,
+                         layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            arrayBytes += static_cast<size_t>(levelWidth) * levelHeight * 4 * layerCount;
+        }
+    }
+
+    // What separate per-body textures would have cost, for the report below.
+    unsigned int requestCount = 0;
+    size_t uniqueBytes = 0;
+    size_t duplicateBytes = 0;
+    for (size_t layer = 0; layer < _images.size(); ++layer)
+    {
+        requestCount += _requests[layer];
+        const DecodedImage& decoded = _images[layer];
+        if (decoded.width == 0)
+            continue;
+
+        size_t bytes = decoded.size();
+        uniqueBytes += bytes;
+        duplicateBytes += bytes * (_requests[layer] - 1);
+
+        if (compressed)
+        {
+            for (GLsizei level = 0; level < levelCount; ++level)
+            {
+                const MipLevel& mipmap = (level == 0 ? decoded : decoded.mipmaps[level - 1]);
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, static_cast<GLint>(layer),
+                                          mipmap.width, mipmap.height, 1,
+                                          format, static_cast<GLsizei>(mipmap.size()), mipmap.data());
+            }
+            continue;
+        }
+
+        QImage image(decoded.data(), decoded.width, decoded.height, QImage::Format_RGBA8888);
+        if (image.width() != width || image.height() != height)
+            image = image.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(layer), width, height, 1,
+                        GL_RGBA, GL_UNSIGNED_BYTE, image.constBits());
+        if (prebuiltMipmaps)
+        {
+            for (GLsizei level = 1; level < levelCount; ++level)
+            {
+                const MipLevel& mipmap = decoded.mipmaps[level - 1];
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, static_cast<GLint>(layer), mipmap.width, mipmap.height, 1,
+                                GL_RGBA, GL_UNSIGNED_BYTE, mipmap.data());
+            }
+        }
+    }
+    if (levelCount > 1 && !prebuiltMipmaps)
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    VERIFY(CG::checkError());
+
+    _images.clear();
+
+    qDebug() << "TextureArray:" << requestCount << "requests," << _paths.size() << "unique images,"
+             << (requestCount - _paths.size()) << "duplicate loads avoided;"
+             << (uniqueBytes + duplicateBytes) / 1024 << "KiB as separate textures,"
+             << arrayBytes / 1024 << "KiB as" << width << "x" << height << (compressed ? "compressed" : "RGBA")
+             << "array with" << levelCount << (prebuiltMipmaps ? "prebuilt" : "generated") << "levels.";
+}
+
+GLuint TextureArray::textureID() const
+{
+    return _textureID;
+}
@@ -0,0 +1,70 @@
+#ifndef TEXTUREARRAY_H
+#define TEXTUREARRAY_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+#include <GL/glew.h>
+
+#include "planets/textureloader.h"
+
+/**
+ * @brief The TextureArray class packs body textures into one GL_TEXTURE_2D_ARRAY
+ *
+ * Every distinct image path gets one layer; requesting the same path again
+ * returns the existing layer, so e.g. all moons share one copy of moon.bmp.
+ * Layers are registered with addLayer() first and uploaded together by
+ * build(), which scales every image to the common layer size. The images
+ * are decoded by the TextureLoader; until the last one arrives, every layer
+ * is a 1x1 grey placeholder.
+ */
+class TextureArray
+{
+public:
+    TextureArray();
+
+    ~TextureArray();
+
+    /**
+     * @brief addLayer Registers an image
+     * @param path the path of the image, e.g. ":/res/images/moon.bmp"
+     * @return the layer index of the image
+     */
+    int addLayer(const std::string& path);
+
+    /**
+     * @brief build Uploads placeholders and queues all registered images for decoding
+     *
+     * The layer size is the largest registered image, capped at
+     * GL_MAX_TEXTURE_SIZE. Needs a current GL context.
+     */
+    void build();
+
+    /**
+     * @brief textureID Getter for the GL texture
+     * @return the GL_TEXTURE_2D_ARRAY name, or 0 before build()
+     */
+    GLuint textureID() const;
+
+private:
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    void upload();
+
+    std::map<std::string, int> _layers;
+    std::vector<std::string> _paths;
+    std::vector<unsigned int> _requests;    /**< Number of addLayer() calls per layer */
+
+    std::vector<DecodedImage> _images;      /**< Decoded layers until upload() */
+    unsigned int _outstanding = 0;
+
+    GLuint _textureID = 0;
+};
+
+#endif // TEXTUREARRAY_H
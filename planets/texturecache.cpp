@@ -0,0 +1,171 @@
+#include "planets/texturecache.h"
+
+#include <algorithm>
+
+#include <QDebug>
+
+#include "gui/config.h"
+#include "planets/textureloader.h"
+
+void TextureSampler::apply(GLenum target) const
+{
+    bool mipmapped = (minFilter != GL_NEAREST && minFilter != GL_LINEAR);
+
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, magFilter);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, wrapS);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, wrapT);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, Config::mipmaps ? 1000 : 0);
+
+    if (mipmapped && Config::mipmaps && GLEW_EXT_texture_filter_anisotropic)
+    {
+        GLfloat maxAnisotropy;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+        glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(Config::maxAnisotropy, maxAnisotropy));
+    }
+}
+
+TextureCache& TextureCache::instance()
+{
+    static TextureCache cache;
+    return cache;
+}
+
+GLuint TextureCache::acquire(const std::string& path, const TextureSampler& sampler)
+{
+    Key key(path, sampler);
+    auto it = _entries.find(key);
+    if (it != _entries.end())
+    {
+        ++_hits;
+        ++it->second.references;
+        return it->second.textureID;
+    }
+
+    ++_misses;
+
+    GLuint texID;
+    glGenTextures(1, &texID);
+    glBindTexture(GL_TEXTURE_2D, texID);
+
+    // Grey placeholder until the decoded image arrives from the TextureLoader.
+    const GLubyte placeholder[4] = { 128, 128, 128, 255 };
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+
+    sampler.apply(GL_TEXTURE_2D);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    size_t bytes = sizeof(placeholder);
+    _entries.emplace(key, Entry{texID, 1, bytes});
+    _keys.emplace(texID, key);
+    _bytesResident += bytes;
+
+    TextureLoader::instance().request(path, true, [this, texID](const DecodedImage& image, const std::vector<const GLvoid*>& levels)
+    {
+        upload(texID, image, levels);
+    }, this);
+
+    return texID;
+}
+
+void TextureCache::upload(GLuint textureID, const DecodedImage& image, const std::vector<const GLvoid*>& levels)
+{
+    auto it = _keys.find(textureID);
+    if (it == _keys.end() || it->second.first != image.path || levels.empty())
+        return;   // evicted meanwhile, or keep the placeholder
+
+    // Block-compressed data is uploaded as it is, without decoding.
+    bool compressed = (image.internalFormat != GL_RGBA8);
+    auto uploadLevel = [&](GLint level, int width, int height, size_t size, const GLvoid* pixels)
+    {
+        if (compressed)
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, image.internalFormat, width, height, 0,
+                                   static_cast<GLsizei>(size), pixels);
+        else
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    };
+
+    size_t bytes = image.size();
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    uploadLevel(0, image.width, image.height, image.size(), levels[0]);
+    if (Config::mipmaps)
+    {
+        for (size_t level = 1; level < levels.size(); ++level)
+        {
+            const MipLevel& mipmap = image.mipmaps[level - 1];
+            uploadLevel(static_cast<GLint>(level), mipmap.width, mipmap.height, mipmap.size(), levels[level]);
+            bytes += mipmap.size();
+        }
+        if (levels.size() == 1 && !compressed)
+        {
+            glGenerateMipmap(GL_TEXTURE_2D);
+            bytes += bytes / 3;
+        }
+        else if (levels.size() == 1)
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    Entry& entry = _entries.find(it->second)->second;
+    _bytesResident -= entry.bytes;
+    entry.bytes = bytes;
+    _bytesResident += entry.bytes;
+}
+
+void TextureCache::release(GLuint textureID)
+{
+    if (textureID == 0)
+        return;
+
+    auto it = _keys.find(textureID);
+    if (it == _keys.end())
+    {
+        qDebug() << "TextureCache::release() called for unknown texture" << textureID;
+        return;
+    }
+
+    Entry& entry = _entries.find(it->second)->second;
+    if (entry.references > 0)
+        --entry.references;
+}
+
+unsigned int TextureCache::evictUnused()
+{
+    unsigned int evicted = 0;
+    for (auto it = _entries.begin(); it != _entries.end();)
+    {
+        if (it->second.references == 0)
+        {
+            glDeleteTextures(1, &it->second.textureID);
+            _bytesResident -= it->second.bytes;
+            _keys.erase(it->second.textureID);
+            it = _entries.erase(it);
+            ++evicted;
+        }
+        else
+            ++it;
+    }
+    return evicted;
+}
+
+unsigned int TextureCache::hits() const
+{
+    return _hits;
+}
+
+unsigned int TextureCache::misses() const
+{
+    return _misses;
+}
+
+size_t TextureCache::bytesResident() const
+{
+    return _bytesResident;
+}
+
+void TextureCache::logStatistics() const
+{
+    qDebug() << "TextureCache:" << _entries.size() << "textures," << _hits << "hits,"
+             << _misses << "misses," << _bytesResident / 1024 << "KiB resident.";
+}
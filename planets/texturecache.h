@@ -0,0 +1,112 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+#include <GL/glew.h>
+
+struct DecodedImage;
+
+// Sampler parameters a cached texture is created with.
+struct TextureSampler
+{
+    GLint minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    GLint magFilter = GL_LINEAR;
+    GLint wrapS = GL_CLAMP_TO_EDGE;
+    GLint wrapT = GL_CLAMP_TO_EDGE;
+
+    /**
+     * @brief apply Sets the parameters on the texture bound to 'target'
+     *
+     * Mipmapped min filters also get anisotropic filtering up to
+     * Config::maxAnisotropy. With Config::mipmaps off, only level 0 is used.
+     */
+    void apply(GLenum target) const;
+
+    bool operator<(const TextureSampler& other) const
+    {
+        return std::tie(minFilter, magFilter, wrapS, wrapT)
+             < std::tie(other.minFilter, other.magFilter, other.wrapS, other.wrapT);
+    }
+};
+
+/**
+ * @brief The TextureCache class shares uploaded textures across the process
+ *
+ * Textures are keyed by image path and sampler parameters. acquire() uploads
+ * an image on the first request and only adds a reference afterwards;
+ * release() drops a reference again. Unreferenced textures stay resident, so
+ * a following acquire() of the same image is still a hit, until evictUnused()
+ * deletes them. Images are decoded by the TextureLoader; until an image is
+ * uploaded, its texture holds a 1x1 grey placeholder. All functions need
+ * the GL context the textures belong to.
+ */
+class TextureCache
+{
+public:
+    /**
+     * @brief instance Returns the process-wide cache
+     */
+    static TextureCache& instance();
+
+    /**
+     * @brief acquire Returns the texture for an image, uploading it if needed
+     * @param path the path of the image, e.g. ":/res/images/moon.bmp"
+     * @param sampler the sampler parameters of the texture
+     * @return the texture; it shows a placeholder until the image is decoded
+     */
+    GLuint acquire(const std::string& path, const TextureSampler& sampler = TextureSampler());
+
+    /**
+     * @brief release Drops one reference to a texture from acquire()
+     * @param textureID the texture; 0 is ignored
+     */
+    void release(GLuint textureID);
+
+    /**
+     * @brief evictUnused Deletes all textures without references
+     * @return the number of deleted textures
+     */
+    unsigned int evictUnused();
+
+    unsigned int hits() const;
+    unsigned int misses() const;
+    size_t bytesResident() const;
+
+    /**
+     * @brief logStatistics Prints the counters with qDebug()
+     */
+    void logStatistics() const;
+
+private:
+    TextureCache() = default;
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    void upload(GLuint textureID, const DecodedImage& image, const std::vector<const GLvoid*>& levels);
+
+    typedef std::pair<std::string, TextureSampler> Key;
+
+    struct Entry
+    {
+        GLuint textureID;
+        unsigned int references;
+        size_t bytes;
+    };
+
+    std::map<Key, Entry> _entries;
+    std::map<GLuint, Key> _keys;
+
+    unsigned int _hits = 0;
+    unsigned int _misses = 0;
+    size_t _bytesResident = 0;
+};
+
+#endif // TEXTURECACHE_H
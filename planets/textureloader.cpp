@@ -0,0 +1,332 @@
+#include "planets/textureloader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QRunnable>
+#include <QThread>
+#include <QDebug>
+
+#include "glbase/gltool.hpp"
+#include "glbase/texload.hpp"
+#include "gui/config.h"
+#include "planets/assetbundle.h"
+
+class DecodeTask : public QRunnable
+{
+public:
+    DecodeTask(TextureLoader* loader, unsigned int id, std::string path, bool flipY, std::string mipDirectory):
+        _loader(loader), _id(id), _path(path), _flipY(flipY), _mipDirectory(mipDirectory)
+    {
+    }
+
+    virtual void run() override
+    {
+        DecodedImage image;
+        image.path = _path;
+
+        if (!loadBundle(image) && !(_flipY && Config::compressedTextures && loadKtx(image)) && !loadMipChain(image))
+        {
+            MipLevel base = decode(QString::fromStdString(_path));
+            image.width = base.width;
+            image.height = base.height;
+            image.pixels = std::move(base.pixels);
+        }
+
+        _loader->finished(_id, std::move(image));
+    }
+
+private:
+    MipLevel decode(const QString& path) const
+    {
+        MipLevel level;
+        QImage tex;
+        tex.load(path);
+        if (tex.isNull())
+            return level;
+
+        tex = tex.convertToFormat(QImage::Format_RGBA8888);
+        if (_flipY)
+            tex = tex.mirrored();
+
+        level.width = tex.width();
+        level.height = tex.height();
+        level.pixels.resize(static_cast<size_t>(level.width) * level.height * 4);
+        for (int y = 0; y < level.height; ++y)
+            std::memcpy(&level.pixels[static_cast<size_t>(y) * level.width * 4],
+                        tex.constScanLine(y), static_cast<size_t>(level.width) * 4);
+        return level;
+    }
+
+    bool loadBundle(DecodedImage& image) const
+    {
+        if (!AssetBundle::instance().texture(_path, _flipY, image))
+            return false;
+
+        if (image.internalFormat != GL_RGBA8 && !(Config::compressedTextures && isSupported(image.internalFormat))
+                && !TextureLoader::decompress(image))
+        {
+            image = DecodedImage();
+            image.path = _path;
+            return false;
+        }
+        return true;
+    }
+
+    static bool isSupported(GLenum internalFormat)
+    {
+        ktx_image ktx;
+        ktx.internal_format = internalFormat;
+        return ktx_supported(ktx);
+    }
+
+    bool loadKtx(DecodedImage& image) const
+    {
+        if (_mipDirectory.empty())
+            return false;
+
+        QFileInfo source(QString::fromStdString(_path));
+        QFile file(QString::fromStdString(_mipDirectory) + "/" + source.completeBaseName() + ".ktx");
+        if (!file.exists() || !file.open(QIODevice::ReadOnly))
+            return false;
+        QByteArray data = file.readAll();
+
+        ktx_image ktx;
+        if (!read_ktx(reinterpret_cast<const unsigned char*>(data.constData()), data.size(), ktx))
+            return false;
+        // GLEW's extension flags are plain globals, so they can be read here.
+        if (!ktx_supported(ktx) && !decompress_ktx(ktx))
+            return false;
+
+        image.internalFormat = ktx.internal_format;
+        image.width = ktx.levels[0].width;
+        image.height = ktx.levels[0].height;
+        image.pixels = std::move(ktx.levels[0].data);
+        for (size_t i = 1; i < ktx.levels.size(); ++i)
+        {
+            MipLevel level;
+            level.width = ktx.levels[i].width;
+            level.height = ktx.levels[i].height;
+            level.pixels = std::move(ktx.levels[i].data);
+            image.mipmaps.push_back(std::move(level));
+        }
+        return true;
+    }
+
+    bool loadMipChain(DecodedImage& image) const
+    {
+        if (_mipDirectory.empty())
+            return false;
+
+        QFileInfo source(QString::fromStdString(_path));
+        QString prefix = QString::fromStdString(_mipDirectory) + "/" + source.completeBaseName() + ".";
+        if (!QFile::exists(prefix + "0.png"))
+            return false;
+
+        std::vector<MipLevel> levels;
+        levels.push_back(decode(prefix + "0.png"));
+        while (levels.back().width > 1 || levels.back().height > 1)
+        {
+            MipLevel level = decode(prefix + QString::number(static_cast<int>(levels.size())) + ".png");
+            if (level.width != std::max(1, levels.back().width / 2)
+                    || level.height != std::max(1, levels.back().height / 2))
+            {
+                qDebug() << "Incomplete mip chain for" << source.fileName() << "in" << QString::fromStdString(_mipDirectory);
+                return false;
+            }
+            levels.push_back(std::move(level));
+        }
+
+        image.width = levels[0].width;
+        image.height = levels[0].height;
+        image.pixels = std::move(levels[0].pixels);
+        image.mipmaps.assign(std::make_move_iterator(levels.begin() + 1), std::make_move_iterator(levels.end()));
+        return true;
+    }
+
+    TextureLoader* _loader;
+    unsigned int _id;
+    std::string _path;
+    bool _flipY;
+    std::string _mipDirectory;
+};
+
+TextureLoader& TextureLoader::instance()
+{
+    static TextureLoader loader;
+    return loader;
+}
+
+TextureLoader::TextureLoader()
+{
+    _pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() - 1));
+}
+
+TextureLoader::~TextureLoader()
+{
+    _pool.waitForDone();
+}
+
+bool TextureLoader::decompress(DecodedImage& image)
+{
+    if (image.internalFormat == GL_RGBA8)
+        return true;
+
+    // Mapped levels are copied, the decompressed pixels are always owned.
+    auto toKtx = [](MipLevel& level)
+    {
+        std::vector<unsigned char> data = level.mapped ? std::vector<unsigned char>(level.data(), level.data() + level.size())
+                                                       : std::move(level.pixels);
+        level.mapped = nullptr;
+        level.mappedSize = 0;
+        return ktx_level{static_cast<unsigned int>(level.width), static_cast<unsigned int>(level.height), std::move(data)};
+    };
+
+    ktx_image ktx;
+    ktx.internal_format = image.internalFormat;
+    ktx.levels.push_back(toKtx(image));
+    for (MipLevel& level : image.mipmaps)
+        ktx.levels.push_back(toKtx(level));
+    bool decompressed = decompress_ktx(ktx);
+
+    image.internalFormat = ktx.internal_format;
+    image.pixels = std::move(ktx.levels[0].data);
+    for (size_t i = 1; i < ktx.levels.size(); ++i)
+        image.mipmaps[i - 1].pixels = std::move(ktx.levels[i].data);
+    return decompressed;
+}
+
+void TextureLoader::setMipDirectory(const std::string& directory)
+{
+    _mipDirectory = directory;
+}
+
+void TextureLoader::request(const std::string& path, bool flipY, UploadFunction upload, const void* owner)
+{
+    unsigned int id = _nextId++;
+    _requests[id] = Request{upload, owner};
+    _pool.start(new DecodeTask(this, id, path, flipY, _mipDirectory));
+}
+
+void TextureLoader::cancel(const void* owner)
+{
+    for (auto it = _requests.begin(); it != _requests.end();)
+    {
+        if (it->second.owner == owner)
+            it = _requests.erase(it);
+        else
+            ++it;
+    }
+}
+
+void TextureLoader::finished(unsigned int id, DecodedImage image)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _finished.emplace_back(id, std::move(image));
+}
+
+unsigned int TextureLoader::processFinished(unsigned int maxUploads)
+{
+    unsigned int uploads = 0;
+    while (uploads < maxUploads)
+    {
+        std::pair<unsigned int, DecodedImage> result;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_finished.empty())
+                break;
+            result = std::move(_finished.front());
+            _finished.pop_front();
+        }
+
+        auto it = _requests.find(result.first);
+        if (it == _requests.end())
+            continue;   // cancelled
+        UploadFunction upload = it->second.upload;
+        _requests.erase(it);
+
+        const DecodedImage& image = result.second;
+        if (image.width == 0)
+        {
+            qDebug() << "Could not load texture file:" << QString::fromStdString(image.path);
+            upload(image, std::vector<const GLvoid*>());
+            continue;
+        }
+
+        std::vector<const GLvoid*> levels;
+        if (image.mapped)
+        {
+            // Mapped bundle data is uploaded in place, without staging.
+            levels.push_back(image.data());
+            for (const MipLevel& level : image.mipmaps)
+                levels.push_back(level.data());
+            upload(image, levels);
+            ++uploads;
+            continue;
+        }
+
+        size_t size = image.size();
+        for (const MipLevel& level : image.mipmaps)
+            size += level.size();
+
+        // Staging through an unpack buffer lets the driver copy to the texture asynchronously.
+        if (_unpackBuffer == 0)
+            glGenBuffers(1, &_unpackBuffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _unpackBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        unsigned char* mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+        if (mapped)
+        {
+            size_t offset = 0;
+            auto stage = [&](const MipLevel& level)
+            {
+                std::memcpy(mapped + offset, level.data(), level.size());
+                levels.push_back(reinterpret_cast<const GLvoid*>(offset));
+                offset += level.size();
+            };
+            stage(image);
+            for (const MipLevel& level : image.mipmaps)
+                stage(level);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            upload(image, levels);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        else
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            levels.push_back(image.data());
+            for (const MipLevel& level : image.mipmaps)
+                levels.push_back(level.data());
+            upload(image, levels);
+        }
+        ++uploads;
+    }
+    VERIFY(CG::checkError());
+    return uploads;
+}
+
+void TextureLoader::finishAll()
+{
+    _pool.waitForDone();
+    processFinished(static_cast<unsigned int>(-1));
+}
+
+void TextureLoader::releaseGL()
+{
+    _requests.clear();
+    if (_unpackBuffer != 0)
+    {
+        glDeleteBuffers(1, &_unpackBuffer);
+        _unpackBuffer = 0;
+    }
+}
+
+unsigned int TextureLoader::pending() const
+{
+    return static_cast<unsigned int>(_requests.size());
+}
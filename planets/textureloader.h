@@ -0,0 +1,166 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+#include <GL/glew.h>
+
+#include <QThreadPool>
+
+/**
+ * @brief The MipLevel struct is one level of a prebuilt mip chain
+ *
+ * The pixels are either owned in 'pixels' or point into a mapped AssetBundle.
+ */
+struct MipLevel
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+    const unsigned char* mapped = nullptr;
+    size_t mappedSize = 0;
+
+    const unsigned char* data() const { return mapped ? mapped : pixels.data(); }
+    size_t size() const { return mapped ? mappedSize : pixels.size(); }
+};
+
+/**
+ * @brief The DecodedImage struct is an image ready for upload
+ *
+ * The base level holds tightly packed 32-bit RGBA if 'internalFormat' is
+ * GL_RGBA8, and compressed blocks for the block-compressed formats of
+ * glbase/texload otherwise. A width of 0 means the image could not be
+ * decoded. If a prebuilt mip chain was found, 'mipmaps' holds levels 1 to n
+ * down to 1x1; otherwise it is empty.
+ */
+struct DecodedImage : public MipLevel
+{
+    std::string path;
+    GLenum internalFormat = GL_RGBA8;
+    std::vector<MipLevel> mipmaps;
+};
+
+/**
+ * @brief The TextureLoader class decodes images on worker threads
+ *
+ * request() queues an image for decoding and returns immediately, so the
+ * caller can show a placeholder in the meantime. processFinished() runs on
+ * the GL thread once per frame: it copies each finished image into a pixel
+ * unpack buffer and calls the upload function of its request with that
+ * buffer bound, so the upload reads from 'levels' as buffer offsets.
+ *
+ * Mip chains built offline by the mipbuild tool are picked up from the mip
+ * directory: for ":/res/images/moon.bmp" these are moon.0.png, moon.1.png,
+ * ... down to 1x1. Images without a complete chain load without mipmaps.
+ * With Config::compressedTextures, a moon.ktx from the ktxbuild tool in the
+ * same directory is preferred; it is decompressed on the worker thread if
+ * the driver cannot sample its format. Images in the open AssetBundle take
+ * precedence over both; they are uploaded straight from the mapped file.
+ */
+class TextureLoader
+{
+public:
+    /**
+     * @brief UploadFunction Uploads a finished image on the GL thread
+     *
+     * 'levels' holds the base level followed by the prebuilt mipmaps; each is to
+     * be passed to glTexImage*() as is, as it is either an offset into the
+     * bound GL_PIXEL_UNPACK_BUFFER or a pointer into the mapped AssetBundle.
+     * It is empty if decoding failed. An upload that passes client memory
+     * instead has to bind 0 to GL_PIXEL_UNPACK_BUFFER first.
+     */
+    typedef std::function<void(const DecodedImage& image, const std::vector<const GLvoid*>& levels)> UploadFunction;
+
+    /**
+     * @brief instance Returns the process-wide loader
+     */
+    static TextureLoader& instance();
+
+    ~TextureLoader();
+
+    /**
+     * @brief setMipDirectory Sets the directory with prebuilt mip chains
+     * @param directory the directory, or an empty string to not look for chains
+     */
+    void setMipDirectory(const std::string& directory);
+
+    /**
+     * @brief request Queues an image for decoding
+     * @param path the path of the image
+     * @param flipY whether to put the last line first, as OpenGL expects for 2D textures
+     * @param upload called from processFinished() once the image is decoded
+     * @param owner identifies the requester for cancel()
+     */
+    void request(const std::string& path, bool flipY, UploadFunction upload, const void* owner = nullptr);
+
+    /**
+     * @brief decompress Converts a block-compressed image to GL_RGBA8
+     * @return false if the format cannot be decompressed on the CPU
+     */
+    static bool decompress(DecodedImage& image);
+
+    /**
+     * @brief cancel Drops the upload functions of all pending requests of an owner
+     */
+    void cancel(const void* owner);
+
+    /**
+     * @brief processFinished Uploads finished images; call with a current GL context
+     * @param maxUploads the maximum number of uploads, to bound the cost per frame
+     * @return the number of uploaded images
+     */
+    unsigned int processFinished(unsigned int maxUploads);
+
+    /**
+     * @brief finishAll Waits for all pending requests and uploads them
+     */
+    void finishAll();
+
+    /**
+     * @brief releaseGL Drops all pending requests and deletes the unpack buffer
+     *
+     * Call with the GL context current before it is destroyed.
+     */
+    void releaseGL();
+
+    /**
+     * @brief pending Getter for the number of requests not uploaded yet
+     */
+    unsigned int pending() const;
+
+private:
+    TextureLoader();
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    struct Request
+    {
+        UploadFunction upload;
+        const void* owner;
+    };
+
+    void finished(unsigned int id, DecodedImage image);
+
+    friend class DecodeTask;
+
+    QThreadPool _pool;
+    GLuint _unpackBuffer = 0;
+    std::string _mipDirectory;
+
+    unsigned int _nextId = 0;
+    std::map<unsigned int, Request> _requests;             // GL thread only
+
+    mutable std::mutex _mutex;
+    std::deque<std::pair<unsigned int, DecodedImage>> _finished; // guarded by _mutex
+};
+
+#endif // TEXTURELOADER_H
@@ -0,0 +1,51 @@
+// Wird an den Phong-Shader der Körper angehängt, dessen main() zu shade()
+// umbenannt ist; dessen Eingaben sind dort globale Variablen, zusammen mit
+// den Ableitungen vTexCoordDx und vTexCoordDy der Texturkoordinaten für
+// textureGrad().
+in vec3 vQuadPosView;
+flat in vec3 vCenterView;
+flat in float vRadius;
+flat in mat3 vRotation;
+
+uniform mat4 projection_matrix;
+
+const float cPi = 3.14159265358979;
+
+void main()
+{
+    // Sichtstrahl vom Auge durch das Fragment, geschnitten mit der Kugel.
+    // Über den nächsten Punkt des Strahls zum Mittelpunkt gerechnet, bleibt
+    // das auch bei kleinen Kugeln in großer Entfernung genau.
+    vec3 dir = normalize(vQuadPosView);
+    float along = dot(dir, vCenterView);
+    vec3 closest = vCenterView - along * dir;
+    float h = vRadius * vRadius - dot(closest, closest);
+    if (h < 0.0)
+        discard;
+    vec3 hit = (along - sqrt(h)) * dir;
+
+    vFragPosView = hit;
+    vNormalView = (hit - vCenterView) / vRadius;
+
+    // Texturkoordinaten wie bei SphereMesh::build(), aus der Normale im Modellraum
+    vec3 local = transpose(vRotation) * vNormalView;
+    float u = fract(atan(local.z, local.x) / (2.0 * cPi));
+    float v = asin(clamp(local.y, -1.0, 1.0)) / cPi + 0.5;
+    vTexCoord = vec2(u, 1.0 - v);
+
+    // An der Naht springt u von 1 auf 0; dort gelten die Ableitungen des verschobenen u
+    float seamU = fract(u + 0.5);
+    vTexCoordDx = vec2(abs(dFdx(u)) < abs(dFdx(seamU)) ? dFdx(u) : dFdx(seamU), dFdx(vTexCoord.y));
+    vTexCoordDy = vec2(abs(dFdy(u)) < abs(dFdy(seamU)) ? dFdy(u) : dFdy(seamU), dFdy(vTexCoord.y));
+
+    shade();
+
+    // Tiefe des getroffenen Punktes statt der des Vierecks
+    vec4 clip = projection_matrix * vec4(hit, 1.0);
+#ifdef ZERO_TO_ONE_DEPTH
+    float depth = clip.z / clip.w;
+#else
+    float depth = 0.5 * clip.z / clip.w + 0.5;
+#endif
+    gl_FragDepth = gl_DepthRange.near + gl_DepthRange.diff * depth;
+}
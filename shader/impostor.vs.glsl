@@ -0,0 +1,41 @@
+#version 330 core
+
+// Pro Instanz: Modelview-Matrix (belegt 3 bis 6), Radius und Textur-Ebene
+layout (location = 3) in mat4 aModelView;
+layout (location = 7) in float aRadius;
+layout (location = 8) in float aLayer;
+
+uniform mat4 projection_matrix;
+
+out vec3 vQuadPosView;          // Punkt auf dem Viereck im View-Space
+flat out vec3 vCenterView;      // Mittelpunkt der Kugel im View-Space
+flat out float vRadius;
+flat out mat3 vRotation;        // Drehung der Kugel, für die Texturkoordinaten
+flat out float vLayer;          // Ebene im Textur-Array
+
+// Ecken des Vierecks als Triangle-Strip, gegen den Uhrzeigersinn von vorne
+const vec2 cCorners[4] = vec2[4](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(-1.0, 1.0), vec2(1.0, 1.0));
+
+void main()
+{
+    vec3 center = vec3(aModelView[3]);
+    float dist = length(center);
+    vec3 forward = center / dist;
+
+    // Das Viereck steht senkrecht zur Blickrichtung auf den Mittelpunkt
+    vec3 helper = abs(forward.y) > 0.99 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(forward, helper));
+    vec3 up = cross(right, forward);
+
+    // Der Kegel der Sichtstrahlen, die die Kugel berühren, hat auf Höhe des
+    // Mittelpunkts den Radius r * d / sqrt(d² - r²); so groß muss das Viereck sein.
+    float halfSize = aRadius * dist / sqrt(max(dist * dist - aRadius * aRadius, 1e-12));
+    vec2 corner = cCorners[gl_VertexID];
+    vQuadPosView = center + (corner.x * right + corner.y * up) * halfSize;
+    gl_Position = projection_matrix * vec4(vQuadPosView, 1.0);
+
+    vCenterView = center;
+    vRadius = aRadius;
+    vRotation = mat3(aModelView);
+    vLayer = aLayer;
+}
@@ -0,0 +1,32 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+// Pro Instanz: Modelview-Matrix (belegt 3 bis 6), Radius und Textur-Ebene
+layout (location = 3) in mat4 aModelView;
+layout (location = 7) in float aRadius;
+layout (location = 8) in float aLayer;
+
+// Uniforms
+uniform mat4 projection_matrix;
+
+// Outputs für den Fragment Shader
+out vec2 vTexCoord;
+out vec3 vNormalView;   // Normale im View-Space
+out vec3 vFragPosView;  // Position im View-Space
+flat out float vLayer;  // Ebene im Textur-Array
+
+void main()
+{
+    // Die Einheitskugel wird pro Instanz auf den Radius skaliert
+    vec4 posView = aModelView * vec4(aPos * aRadius, 1.0);
+    gl_Position = projection_matrix * posView;
+
+    vFragPosView = vec3(posView);
+    // Gleichmäßige Skalierung ändert die Richtung der Normalen nicht
+    vNormalView = mat3(aModelView) * aNormal;
+
+    vTexCoord = aTexCoord;
+    vLayer = aLayer;
+}
@@ -0,0 +1,46 @@
+// Erzeugt die Geometrie ohne Vertex-Buffer aus gl_VertexID, gezeichnet mit
+// glDrawArrays(GL_TRIANGLES, 0, 6 * uSegments * uSegments) für die Kugel und
+// glDrawArrays(GL_TRIANGLES, 0, 6 * uSegments) für den Kreisring. Die Werte
+// entsprechen genau denen der Meshes aus SphereMesh::build(), Ring und Orbit.
+uniform int uSegments;
+uniform float uInnerRadius;
+uniform float uOuterRadius;
+
+// Ersetzen die Vertex-Attribute 0 bis 2
+vec3 aPos;
+vec3 aNormal;
+vec2 aTexCoord;
+
+// Ecken der zwei Dreiecke eines Vierecks, wie in den Indexlisten der Meshes
+const ivec2 cCorners[6] = ivec2[6](ivec2(0, 0), ivec2(1, 0), ivec2(0, 1),
+                                   ivec2(0, 1), ivec2(1, 0), ivec2(1, 1));
+
+void proceduralVertex()
+{
+    int quad = gl_VertexID / 6;
+    ivec2 corner = cCorners[gl_VertexID - quad * 6];
+
+#ifdef PROCEDURAL_SPHERE
+    // Breitengrad i von Süden nach Norden, Längengrad j
+    int i = quad / uSegments + corner.x;
+    int j = quad - (quad / uSegments) * uSegments + corner.y;
+    float v = float(i) / float(uSegments);
+    float u = float(j) / float(uSegments);
+    float latitude = radians(-90.0 + v * 180.0);
+    float longitude = radians(u * 360.0);
+
+    aPos = vec3(cos(latitude) * cos(longitude), sin(latitude), cos(latitude) * sin(longitude));
+    aNormal = aPos;
+    aTexCoord = vec2(u, 1.0 - v);
+#else
+    // Schritt i um den Ring, innen (0) oder außen (1)
+    int i = quad + corner.x;
+    float u = float(i) / float(uSegments);
+    float angle = radians(u * 360.0);
+    float radius = corner.y == 0 ? uInnerRadius : uOuterRadius;
+
+    aPos = vec3(radius * cos(angle), 0.0, radius * sin(angle));
+    aNormal = vec3(0.0, 1.0, 0.0);
+    aTexCoord = vec2(float(corner.y), u);
+#endif
+}
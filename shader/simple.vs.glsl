@@ -2,7 +2,7 @@
 
 // Nimmt nur die Position entgegen (location = 0),
 // da wir Normals und TexCoords für eine simple Farbe nicht brauchen.
-layout (location = 0) in vec3 aPosition;
+layout (location = 0) in vec3 aPos;
 
 uniform mat4 projection_matrix;
 uniform mat4 modelview_matrix;
@@ -10,5 +10,5 @@ uniform mat4 modelview_matrix;
 void main()
 {
     // Berechne die Position und gib sie weiter
-    gl_Position = projection_matrix * modelview_matrix * vec4(aPosition, 1.0);
+    gl_Position = projection_matrix * modelview_matrix * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -11,6 +11,11 @@ void main()
     TexCoords = aPos;
     vec4 pos = projection * view * vec4(aPos, 1.0);
 
+#ifdef REVERSED_Z
+    // Bei umgekehrter Tiefe liegt die ferne Ebene bei 0.0
+    gl_Position = vec4(pos.xy, 0.0, pos.w);
+#else
     // Dieser Trick setzt die Tiefe (z/w) auf 1.0
     gl_Position = pos.xyww;
+#endif
 }
\ No newline at end of file
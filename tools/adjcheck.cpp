@@ -0,0 +1,125 @@
+/*
+ * Adjacency checker.
+ *
+ * Usage: adjcheck [lists [subdivisions]]
+ *
+ * Compares create_adjacency() (see glbase/geometries.hpp) with the original
+ * O(n^2) search over all triangle pairs, which is kept below as reference:
+ * on 'lists' random index lists (default 20000), which include degenerate
+ * triangles and edges shared by more than two triangles, and on closed
+ * icospheres. Then it times create_adjacency() on an icosphere with the
+ * given subdivision level (default 8, 1310720 triangles). Exits with 1 on
+ * the first mismatch.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "geometries.hpp"
+
+namespace {
+
+std::vector<unsigned int> reference_adjacency(const std::vector<unsigned int>& indices)
+{
+    std::vector<unsigned int> indices_with_adjacency(indices.size() / 3 * 6);
+    for (size_t t = 0; t < indices.size() / 3; t++) {
+        unsigned int v[3] = { indices[3 * t + 0], indices[3 * t + 1], indices[3 * t + 2] };
+        unsigned int nv[3] = { v[2], v[0], v[1] }; // neighbor triangle vertices for edges 0, 1, 2
+        for (size_t nt = 0; nt < indices.size() / 3; nt++) {
+            if (nt == t)
+                continue;
+            unsigned int test_nv[3] = { indices[3 * nt + 0], indices[3 * nt + 1], indices[3 * nt + 2] };
+            // edge 0
+            if (nv[0] == v[2]) {
+                if (v[0] == test_nv[1] && v[1] == test_nv[0])
+                    nv[0] = test_nv[2];
+                else if (v[0] == test_nv[2] && v[1] == test_nv[1])
+                    nv[0] = test_nv[0];
+                else if (v[0] == test_nv[0] && v[1] == test_nv[2])
+                    nv[0] = test_nv[1];
+            }
+            // edge 1
+            if (nv[1] == v[0]) {
+                if (v[1] == test_nv[1] && v[2] == test_nv[0])
+                    nv[1] = test_nv[2];
+                else if (v[1] == test_nv[2] && v[2] == test_nv[1])
+                    nv[1] = test_nv[0];
+                else if (v[1] == test_nv[0] && v[2] == test_nv[2])
+                    nv[1] = test_nv[1];
+            }
+            // edge 2
+            if (nv[2] == v[1]) {
+                if (v[2] == test_nv[1] && v[0] == test_nv[0])
+                    nv[2] = test_nv[2];
+                else if (v[2] == test_nv[2] && v[0] == test_nv[1])
+                    nv[2] = test_nv[0];
+                else if (v[2] == test_nv[0] && v[0] == test_nv[2])
+                    nv[2] = test_nv[1];
+            }
+            if (nv[0] != v[2] && nv[1] != v[0] && nv[2] != v[1])
+                break;
+        }
+        indices_with_adjacency[6 * t + 0] = v[0];
+        indices_with_adjacency[6 * t + 1] = nv[0];
+        indices_with_adjacency[6 * t + 2] = v[1];
+        indices_with_adjacency[6 * t + 3] = nv[1];
+        indices_with_adjacency[6 * t + 4] = v[2];
+        indices_with_adjacency[6 * t + 5] = nv[2];
+    }
+    return indices_with_adjacency;
+}
+
+bool check(const std::vector<unsigned int>& indices, const char* what)
+{
+    if (create_adjacency(indices) == reference_adjacency(indices))
+        return true;
+    fprintf(stderr, "create_adjacency differs from the reference for %s (%zu triangles)\n",
+            what, indices.size() / 3);
+    return false;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned long lists = (argc > 1 ? std::strtoul(argv[1], NULL, 10) : 20000);
+    int subdivisions = (argc > 2 ? std::atoi(argv[2]) : 8);
+
+    // Few vertices and many triangles, so edges repeat in both directions and
+    // triangles degenerate; that exercises every tie of the neighbor search.
+    std::mt19937 random(1);
+    for (unsigned long i = 0; i < lists; i++) {
+        unsigned int vertex_count = 3 + random() % 10;
+        unsigned int triangle_count = 1 + random() % 40;
+        std::vector<unsigned int> indices(3 * triangle_count);
+        for (size_t j = 0; j < indices.size(); j++)
+            indices[j] = random() % vertex_count;
+        char what[64];
+        snprintf(what, sizeof(what), "random list %lu", i);
+        if (!check(indices, what))
+            return 1;
+    }
+    printf("%lu random index lists match\n", lists);
+
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> texcoords;
+    std::vector<unsigned int> indices;
+    for (int level = 0; level <= 3; level++) {
+        geom_icosphere(positions, normals, texcoords, indices, level);
+        char what[64];
+        snprintf(what, sizeof(what), "icosphere %d", level);
+        if (!check(indices, what))
+            return 1;
+    }
+    printf("icospheres 0 to 3 match\n");
+
+    geom_icosphere(positions, normals, texcoords, indices, subdivisions);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<unsigned int> adjacency = create_adjacency(indices);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("create_adjacency: %zu triangles in %.1f ms\n", indices.size() / 3, ms);
+    return adjacency.size() == 2 * indices.size() ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+/*
+ * Asset bundle packer.
+ *
+ * Usage: bundlepack <output> [-p <prefix>] [-f bc1|bc3|rgba] [-c] <file>...
+ *
+ * Packs textures and shader sources into one bundle file (see
+ * glbase/assetbundle.hpp) that the application maps at startup. The options
+ * apply to all files that follow them:
+ *   -p <prefix>  name the entries <prefix><basename>, e.g. -p :/res/images/
+ *   -f <format>  encode images as BC1, BC3 or uncompressed RGBA (default: rgba)
+ *   -c           store the following images as cube map faces: line 0 at the
+ *                top and without mipmaps
+ *
+ * PNG and BMP files become textures with their full mip chain, lines stored
+ * bottom-up. KTX files are copied as they are. All other files are stored as
+ * blobs. A later file with the same entry name replaces an earlier one.
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "texload.hpp"
+#include "assetbundle.hpp"
+
+#include "imagetool.hpp"
+
+struct packed_entry {
+    bundle_entry entry;
+    std::vector<std::vector<unsigned char>> levels;
+};
+
+static std::string extension(const std::string& filename)
+{
+    size_t dot = filename.find_last_of('.');
+    std::string ext = (dot == std::string::npos ? "" : filename.substr(dot + 1));
+    for (char& c : ext)
+        c = static_cast<char>(std::tolower(c));
+    return ext;
+}
+
+static bool pack_file(const std::string& filename, const std::string& prefix, GLenum format, bool cube_face,
+        packed_entry& packed)
+{
+    std::memset(&packed.entry, 0, sizeof(packed.entry));
+    std::string name = prefix + image_basename(filename);
+    if (name.size() >= sizeof(packed.entry.name)) {
+        fprintf(stderr, "%s: entry name too long\n", name.c_str());
+        return false;
+    }
+    std::strcpy(packed.entry.name, name.c_str());
+
+    std::string ext = extension(filename);
+    if (ext == "ktx") {
+        ktx_image ktx;
+        if (!read_ktx(filename, ktx))
+            return false;
+        packed.entry.kind = bundle_texture;
+        packed.entry.internal_format = ktx.internal_format;
+        packed.entry.width = ktx.levels[0].width;
+        packed.entry.height = ktx.levels[0].height;
+        packed.entry.flags = bundle_bottom_up;
+        for (size_t i = 0; i < ktx.levels.size(); i++)
+            packed.levels.push_back(ktx.levels[i].data);
+    } else if (ext == "png" || ext == "bmp") {
+        Image image;
+        if (!load_image(filename, image))
+            return false;
+        packed.entry.kind = bundle_texture;
+        packed.entry.internal_format = format;
+        packed.entry.width = image.width;
+        packed.entry.height = image.height;
+        packed.entry.flags = (cube_face ? 0 : bundle_bottom_up);
+        for (;;) {
+            packed.levels.push_back(encode_level(image, format, !cube_face).data);
+            if (cube_face || (image.width == 1 && image.height == 1))
+                break;
+            image = downsample(image);
+        }
+    } else {
+        std::vector<unsigned char> data;
+        FILE* f = std::fopen(filename.c_str(), "rb");
+        if (!f) {
+            fprintf(stderr, "%s: cannot read file\n", filename.c_str());
+            return false;
+        }
+        unsigned char buffer[4096];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), f)) > 0)
+            data.insert(data.end(), buffer, buffer + n);
+        std::fclose(f);
+        packed.entry.kind = bundle_blob;
+        packed.levels.push_back(data);
+    }
+    packed.entry.level_count = static_cast<uint32_t>(packed.levels.size());
+    return true;
+}
+
+static bool write_bundle(const std::string& filename, std::vector<packed_entry>& entries)
+{
+    uint64_t offset = bundle_align(sizeof(bundle_header) + entries.size() * sizeof(bundle_entry));
+    for (size_t i = 0; i < entries.size(); i++) {
+        entries[i].entry.offset = offset;
+        for (size_t l = 0; l < entries[i].levels.size(); l++)
+            offset = (l == 0 ? offset : bundle_align(offset)) + entries[i].levels[l].size();
+        entries[i].entry.size = offset - entries[i].entry.offset;
+        offset = bundle_align(offset);
+    }
+
+    bundle_header header;
+    std::memcpy(header.magic, bundle_magic, 4);
+    header.version = bundle_version;
+    header.entry_count = static_cast<uint32_t>(entries.size());
+    header.reserved = 0;
+
+    FILE* f = std::fopen(filename.c_str(), "wb");
+    if (!f) {
+        fprintf(stderr, "%s: cannot write file\n", filename.c_str());
+        return false;
+    }
+    const unsigned char padding[bundle_alignment] = { 0 };
+    uint64_t written = sizeof(header);
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+    for (size_t i = 0; ok && i < entries.size(); i++) {
+        ok = std::fwrite(&entries[i].entry, sizeof(bundle_entry), 1, f) == 1;
+        written += sizeof(bundle_entry);
+    }
+    for (size_t i = 0; ok && i < entries.size(); i++) {
+        for (size_t l = 0; ok && l < entries[i].levels.size(); l++) {
+            uint64_t pad = bundle_align(written) - written;
+            const std::vector<unsigned char>& data = entries[i].levels[l];
+            ok = (pad == 0 || std::fwrite(padding, pad, 1, f) == 1)
+                && (data.empty() || std::fwrite(&data[0], data.size(), 1, f) == 1);
+            written += pad + data.size();
+        }
+    }
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok)
+        fprintf(stderr, "%s: cannot write file\n", filename.c_str());
+    else
+        printf("%s: %zu entries, %llu KiB\n", filename.c_str(), entries.size(),
+                static_cast<unsigned long long>(written / 1024));
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    const uint16_t byte_order = 1;
+    if (*reinterpret_cast<const unsigned char*>(&byte_order) != 1) {
+        fprintf(stderr, "%s: bundles can only be written on little endian hosts\n", argv[0]);
+        return 1;
+    }
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <output> [-p <prefix>] [-f bc1|bc3|rgba] [-c] <file>...\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<packed_entry> entries;
+    std::string prefix;
+    GLenum format = GL_RGBA8;
+    bool cube_face = false;
+    int errors = 0;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-p" && i + 1 < argc) {
+            prefix = argv[++i];
+        } else if (arg == "-f" && i + 1 < argc) {
+            std::string name = argv[++i];
+            format = (name == "bc1" ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                    : name == "bc3" ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                    : GL_RGBA8);
+        } else if (arg == "-c") {
+            cube_face = true;
+        } else {
+            packed_entry packed;
+            if (!pack_file(arg, prefix, format, cube_face, packed)) {
+                errors++;
+                continue;
+            }
+            bool replaced = false;
+            for (size_t e = 0; e < entries.size(); e++) {
+                if (std::strcmp(entries[e].entry.name, packed.entry.name) == 0) {
+                    entries[e] = packed;
+                    replaced = true;
+                }
+            }
+            if (!replaced)
+                entries.push_back(packed);
+        }
+    }
+
+    if (errors > 0 || !write_bundle(argv[1], entries))
+        return 1;
+    return 0;
+}
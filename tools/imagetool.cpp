@@ -0,0 +1,270 @@
+/*
+ * Image helpers shared by the offline texture tools.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+#include "lodepng.h"
+
+#include "imagetool.hpp"
+
+static unsigned int read_le(const unsigned char* p, int bytes)
+{
+    unsigned int v = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static bool load_bmp(const std::string& filename, Image& image)
+{
+    std::vector<unsigned char> file;
+    lodepng::load_file(file, filename);
+    if (file.size() < 54
+            || file[0] != 'B' || file[1] != 'M') {
+        fprintf(stderr, "%s: not a BMP file\n", filename.c_str());
+        return false;
+    }
+
+    unsigned int offset = read_le(&file[10], 4);
+    int width = static_cast<int>(read_le(&file[18], 4));
+    int height = static_cast<int>(read_le(&file[22], 4));
+    unsigned int bpp = read_le(&file[28], 2);
+    unsigned int compression = read_le(&file[30], 4);
+    if ((bpp != 24 && bpp != 32) || (compression != 0 && compression != 3) || width <= 0 || height == 0) {
+        fprintf(stderr, "%s: only uncompressed 24/32-bit BMP files are supported\n", filename.c_str());
+        return false;
+    }
+
+    // Positive heights are stored bottom-up.
+    bool bottom_up = height > 0;
+    height = std::abs(height);
+    size_t pixel_size = bpp / 8;
+    size_t line_size = (width * pixel_size + 3) & ~size_t(3);
+    if (offset + line_size * height > file.size()) {
+        fprintf(stderr, "%s: truncated BMP file\n", filename.c_str());
+        return false;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.rgba.resize(4 * size_t(width) * height);
+    for (int y = 0; y < height; y++) {
+        const unsigned char* src = &file[offset + line_size * (bottom_up ? height - 1 - y : y)];
+        unsigned char* dst = &image.rgba[4 * size_t(width) * y];
+        for (int x = 0; x < width; x++) {
+            dst[4 * x + 0] = src[pixel_size * x + 2];
+            dst[4 * x + 1] = src[pixel_size * x + 1];
+            dst[4 * x + 2] = src[pixel_size * x + 0];
+            dst[4 * x + 3] = (bpp == 32 ? src[pixel_size * x + 3] : 255);
+        }
+    }
+    return true;
+}
+
+bool load_image(const std::string& filename, Image& image)
+{
+    std::string ext = filename.substr(filename.find_last_of('.') + 1);
+    if (ext == "bmp" || ext == "BMP")
+        return load_bmp(filename, image);
+
+    unsigned error = lodepng::decode(image.rgba, image.width, image.height, filename);
+    if (error) {
+        fprintf(stderr, "%s: png decoder error %d: %s\n", filename.c_str(), error, lodepng_error_text(error));
+        return false;
+    }
+    return true;
+}
+
+static float srgb_to_linear(unsigned char c)
+{
+    float v = c / 255.0f;
+    return (v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f));
+}
+
+static unsigned char linear_to_srgb(float v)
+{
+    float c = (v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f);
+    return static_cast<unsigned char>(std::fmin(std::fmax(c * 255.0f + 0.5f, 0.0f), 255.0f));
+}
+
+Image downsample(const Image& src)
+{
+    static std::vector<float> to_linear;
+    if (to_linear.empty()) {
+        to_linear.resize(256);
+        for (int i = 0; i < 256; i++)
+            to_linear[i] = srgb_to_linear(static_cast<unsigned char>(i));
+    }
+
+    Image dst;
+    dst.width = std::max(1u, src.width / 2);
+    dst.height = std::max(1u, src.height / 2);
+    dst.rgba.resize(4 * size_t(dst.width) * dst.height);
+
+    for (unsigned int y = 0; y < dst.height; y++) {
+        unsigned int y0 = std::min(2 * y, src.height - 1);
+        unsigned int y1 = std::min(2 * y + 1, src.height - 1);
+        for (unsigned int x = 0; x < dst.width; x++) {
+            unsigned int x0 = std::min(2 * x, src.width - 1);
+            unsigned int x1 = std::min(2 * x + 1, src.width - 1);
+            const unsigned char* p[4] = {
+                &src.rgba[4 * (size_t(y0) * src.width + x0)], &src.rgba[4 * (size_t(y0) * src.width + x1)],
+                &src.rgba[4 * (size_t(y1) * src.width + x0)], &src.rgba[4 * (size_t(y1) * src.width + x1)]
+            };
+            unsigned char* d = &dst.rgba[4 * (size_t(y) * dst.width + x)];
+            for (int c = 0; c < 3; c++)
+                d[c] = linear_to_srgb(0.25f * (to_linear[p[0][c]] + to_linear[p[1][c]]
+                                             + to_linear[p[2][c]] + to_linear[p[3][c]]));
+            d[3] = static_cast<unsigned char>((p[0][3] + p[1][3] + p[2][3] + p[3][3] + 2) / 4);
+        }
+    }
+    return dst;
+}
+
+std::string image_basename(const std::string& filename)
+{
+    std::string basename = filename.substr(filename.find_last_of("/\\") + 1);
+    return basename.substr(0, basename.find_last_of('.'));
+}
+
+static unsigned int to_565(const unsigned char* c)
+{
+    return ((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3);
+}
+
+static void from_565(unsigned int c, int* rgb)
+{
+    rgb[0] = ((c >> 11) & 31) * 255 / 31;
+    rgb[1] = ((c >> 5) & 63) * 255 / 63;
+    rgb[2] = (c & 31) * 255 / 31;
+}
+
+static void encode_color_block(const unsigned char pixels[16][4], unsigned char* out)
+{
+    int lo[3] = { 255, 255, 255 };
+    int hi[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            lo[c] = std::min(lo[c], int(pixels[i][c]));
+            hi[c] = std::max(hi[c], int(pixels[i][c]));
+        }
+    }
+    // Insetting the box by 1/16 of its size reduces the error of the outer colors.
+    unsigned char c_hi[3], c_lo[3];
+    for (int c = 0; c < 3; c++) {
+        int inset = (hi[c] - lo[c]) / 16;
+        c_hi[c] = static_cast<unsigned char>(hi[c] - inset);
+        c_lo[c] = static_cast<unsigned char>(lo[c] + inset);
+    }
+
+    unsigned int c0 = to_565(c_hi);
+    unsigned int c1 = to_565(c_lo);
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    int palette[4][3];
+    from_565(c0, palette[0]);
+    from_565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+    }
+
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        for (int i = 15; i >= 0; i--) {
+            int best = 0;
+            int best_dist = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int dist = 0;
+                for (int c = 0; c < 3; c++)
+                    dist += (pixels[i][c] - palette[p][c]) * (pixels[i][c] - palette[p][c]);
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best = p;
+                }
+            }
+            indices = (indices << 2) | best;
+        }
+    }
+
+    out[0] = c0 & 0xff;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xff;
+    out[3] = c1 >> 8;
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+static void encode_alpha_block(const unsigned char pixels[16][4], unsigned char* out)
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++) {
+        a0 = std::max(a0, int(pixels[i][3]));
+        a1 = std::min(a1, int(pixels[i][3]));
+    }
+
+    int palette[8] = { a0, a1 };
+    for (int i = 1; i < 7; i++)
+        palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+
+    uint64_t indices = 0;
+    if (a0 != a1) {
+        for (int i = 15; i >= 0; i--) {
+            int best = 0;
+            for (int p = 1; p < 8; p++)
+                if (std::abs(pixels[i][3] - palette[p]) < std::abs(pixels[i][3] - palette[best]))
+                    best = p;
+            indices = (indices << 3) | best;
+        }
+    }
+
+    out[0] = static_cast<unsigned char>(a0);
+    out[1] = static_cast<unsigned char>(a1);
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+ktx_level encode_level(const Image& image, GLenum format, bool bottom_up)
+{
+    ktx_level level;
+    level.width = image.width;
+    level.height = image.height;
+
+    if (format == GL_RGBA8) {
+        size_t line_size = 4 * size_t(image.width);
+        level.data.resize(line_size * image.height);
+        for (unsigned int y = 0; y < image.height; y++)
+            std::memcpy(&level.data[line_size * y], &image.rgba[line_size * (bottom_up ? image.height - 1 - y : y)], line_size);
+        return level;
+    }
+
+    size_t block_size = (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? 16 : 8);
+    unsigned int blocks_x = (image.width + 3) / 4;
+    unsigned int blocks_y = (image.height + 3) / 4;
+    level.data.resize(block_size * blocks_x * blocks_y);
+    for (unsigned int by = 0; by < blocks_y; by++) {
+        for (unsigned int bx = 0; bx < blocks_x; bx++) {
+            unsigned char pixels[16][4];
+            for (unsigned int i = 0; i < 16; i++) {
+                // Blocks at the border repeat their last line and column.
+                unsigned int x = std::min(4 * bx + i % 4, image.width - 1);
+                unsigned int y = std::min(4 * by + i / 4, image.height - 1);
+                size_t line = (bottom_up ? image.height - 1 - y : y);
+                std::memcpy(pixels[i], &image.rgba[4 * (line * image.width + x)], 4);
+            }
+            unsigned char* out = &level.data[block_size * (size_t(by) * blocks_x + bx)];
+            if (block_size == 16) {
+                encode_alpha_block(pixels, out);
+                out += 8;
+            }
+            encode_color_block(pixels, out);
+        }
+    }
+    return level;
+}
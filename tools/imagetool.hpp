@@ -0,0 +1,42 @@
+/*
+ * Image helpers shared by the offline texture tools.
+ */
+
+#ifndef IMAGETOOL_HPP
+#define IMAGETOOL_HPP
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "texload.hpp"
+
+struct Image
+{
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<unsigned char> rgba;    // line 0 at the top
+};
+
+/* Reads a PNG, or an uncompressed 24/32-bit BMP, as 8-bit RGBA.
+ * Prints an error and returns false on failure. */
+bool load_image(const std::string& filename, Image& image);
+
+/* Halves the image with a box filter in linear light, because averaging the
+ * sRGB values directly darkens high-contrast regions of the smaller levels.
+ * The result is at least 1x1. */
+Image downsample(const Image& src);
+
+/* Encodes one level as GL_RGBA8, or block compressed as
+ * GL_COMPRESSED_RGB_S3TC_DXT1_EXT (BC1) or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+ * (BC3). The encoder fits each 4x4 block to the inset bounding box of its
+ * colors, which is fast and good enough for planet surfaces. With 'bottom_up',
+ * line 0 of the result is the last line of the image, as OpenGL expects for
+ * 2D textures. */
+ktx_level encode_level(const Image& image, GLenum format, bool bottom_up);
+
+/* Returns the file name of 'filename' without directory and extension. */
+std::string image_basename(const std::string& filename);
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Offline KTX converter.
+ *
+ * Usage: ktxbuild [-f bc1|bc3|rgba] <output-dir> <image>...
+ *
+ * Reads each image (PNG, or uncompressed 24/32-bit BMP) and writes it with its
+ * full mip chain to <output-dir>/<basename>.ktx, block compressed with BC1
+ * (the default, 4 bits per pixel), BC3 (8 bits per pixel, with alpha) or
+ * uncompressed. Lines are stored bottom-up as glbase/texload expects.
+ * The reported PSNR of level 0 is measured against the CPU decompression of
+ * the written data.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "texload.hpp"
+
+#include "imagetool.hpp"
+
+static double psnr(const Image& image, const ktx_level& level)
+{
+    double sum = 0.0;
+    for (unsigned int y = 0; y < image.height; y++) {
+        for (unsigned int x = 0; x < image.width; x++) {
+            const unsigned char* a = &image.rgba[4 * (size_t(image.height - 1 - y) * image.width + x)];
+            const unsigned char* b = &level.data[4 * (size_t(y) * image.width + x)];
+            for (int c = 0; c < 3; c++)
+                sum += double(a[c] - b[c]) * (a[c] - b[c]);
+        }
+    }
+    double mse = sum / (3.0 * image.width * image.height);
+    return (mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0);
+}
+
+int main(int argc, char* argv[])
+{
+    GLenum format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    int first = 1;
+    if (argc > 2 && std::strcmp(argv[1], "-f") == 0) {
+        std::string name = argv[2];
+        format = (name == "bc1" ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                : name == "bc3" ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                : name == "rgba" ? GL_RGBA8 : GL_NONE);
+        first = 3;
+    }
+    if (format == GL_NONE || argc < first + 2) {
+        fprintf(stderr, "Usage: %s [-f bc1|bc3|rgba] <output-dir> <image>...\n", argv[0]);
+        return 1;
+    }
+
+    std::string output_dir = argv[first];
+    int errors = 0;
+    for (int i = first + 1; i < argc; i++) {
+        std::string filename = argv[i];
+        Image image;
+        if (!load_image(filename, image)) {
+            errors++;
+            continue;
+        }
+        Image base = image;
+
+        ktx_image ktx;
+        ktx.internal_format = format;
+        for (;;) {
+            ktx.levels.push_back(encode_level(image, format, true));
+            if (image.width == 1 && image.height == 1)
+                break;
+            image = downsample(image);
+        }
+
+        std::string ktx_name = output_dir + "/" + image_basename(filename) + ".ktx";
+        if (!write_ktx(ktx_name, ktx)) {
+            errors++;
+            continue;
+        }
+
+        size_t bytes = 0;
+        for (const ktx_level& level : ktx.levels)
+            bytes += level.data.size();
+        ktx_image check;
+        check.internal_format = format;
+        check.levels.push_back(ktx.levels[0]);
+        decompress_ktx(check);
+        printf("%s: %zu levels, %zu KiB (%.1fx smaller than RGBA), PSNR %.1f dB\n", filename.c_str(),
+                ktx.levels.size(), bytes / 1024, 4.0 * base.width * base.height * 4 / 3 / bytes,
+                psnr(base, check.levels[0]));
+    }
+    return (errors == 0 ? 0 : 1);
+}
@@ -0,0 +1,57 @@
+/*
+ * Offline mip chain builder.
+ *
+ * Usage: mipbuild <output-dir> <image>...
+ *
+ * Reads each image (PNG, or uncompressed 24/32-bit BMP) and writes its mip
+ * chain as <output-dir>/<basename>.<level>.png, from the full image at level 0
+ * down to 1x1, box filtered in linear light. PNG stores line 0 at the top, so
+ * the files load like the source images.
+ */
+
+#include <cstdio>
+#include <string>
+
+#include "lodepng.h"
+
+#include "imagetool.hpp"
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <output-dir> <image>...\n", argv[0]);
+        return 1;
+    }
+
+    std::string output_dir = argv[1];
+    int errors = 0;
+    for (int i = 2; i < argc; i++) {
+        std::string filename = argv[i];
+        Image image;
+        if (!load_image(filename, image)) {
+            errors++;
+            continue;
+        }
+
+        std::string basename = image_basename(filename);
+
+        size_t bytes = 0;
+        unsigned int level = 0;
+        for (;;) {
+            std::string level_name = output_dir + "/" + basename + "." + std::to_string(level) + ".png";
+            unsigned error = lodepng::encode(level_name, image.rgba, image.width, image.height);
+            if (error) {
+                fprintf(stderr, "%s: png encoder error %d: %s\n", level_name.c_str(), error, lodepng_error_text(error));
+                errors++;
+                break;
+            }
+            bytes += image.rgba.size();
+            if (image.width == 1 && image.height == 1)
+                break;
+            image = downsample(image);
+            level++;
+        }
+        printf("%s: %u levels, %zu KiB uncompressed\n", filename.c_str(), level + 1, bytes / 1024);
+    }
+    return (errors == 0 ? 0 : 1);
+}
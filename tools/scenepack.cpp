@@ -0,0 +1,50 @@
+/*
+ * Scene packer.
+ *
+ * Usage: scenepack <input.json> <output.scene>
+ *
+ * Converts a text scene description into the binary format that the
+ * application reads for deployment (see glbase/sceneload.hpp). The input is
+ * fully validated, so errors show up here rather than at startup.
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "sceneload.hpp"
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <input.json> <output.scene>\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<char> data;
+    FILE* f = std::fopen(argv[1], "rb");
+    if (!f) {
+        fprintf(stderr, "%s: cannot read file\n", argv[1]);
+        return 1;
+    }
+    char buffer[4096];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), f)) > 0)
+        data.insert(data.end(), buffer, buffer + n);
+    std::fclose(f);
+
+    std::vector<scene_body> bodies;
+    std::string error;
+    bool ok = read_scene_json(data.empty() ? "" : &data[0], data.size(),
+            [&](const scene_body& body) { bodies.push_back(body); return true; }, error);
+    if (!ok) {
+        fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+        return 1;
+    }
+    if (!write_scene_binary(argv[2], bodies)) {
+        fprintf(stderr, "%s: cannot write file\n", argv[2]);
+        return 1;
+    }
+    printf("%s: %zu bodies\n", argv[2], bodies.size());
+    return 0;
+}